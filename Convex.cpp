@@ -0,0 +1,256 @@
+#include "Convex.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+/***********************************************************
+* Function to compute the convex hull (monotone chain)
+***********************************************************/
+std::vector<Vec2r> convex_hull(std::vector<Vec2r> p)
+{
+  TRACE_ZONE("convex_hull");
+
+  std::sort(p.begin(), p.end(), [](const Vec2r& a, const Vec2r& b)
+  { return a[0] < b[0] || (a[0] == b[0] && a[1] < b[1]); });
+
+  int N = p.size();
+  if (N < 3)
+    return p;
+
+  std::vector<Vec2r> h(2 * N);
+  int k = 0;
+
+  // Lower hull from left to right
+  for (int i = 0; i < N; ++i)
+  {
+    while (k >= 2 && orientation(h[k-2], h[k-1], p[i]) != Orient::CCW)
+      --k;
+    h[k++] = p[i];
+  }
+
+  // Upper hull from right to left
+  for (int i = N-2, lo = k+1; i >= 0; --i)
+  {
+    while (k >= lo && orientation(h[k-2], h[k-1], p[i]) != Orient::CCW)
+      --k;
+    h[k++] = p[i];
+  }
+
+  // The last node equals the first one
+  h.resize(maximum(k - 1, 1));
+
+  if (h.size() == 2 && h[0] == h[1])
+    h.resize(1);
+
+  return h;
+}
+
+/***********************************************************
+* Function to check if a polygon is convex
+***********************************************************/
+bool is_convex(const std::vector<Vec2r>& c)
+{
+  int N = c.size();
+  bool cw = false, ccw = false;
+
+  for (int i = 0; i < N; ++i)
+  {
+    Orient o = orientation(c[i], c[(i+1)%N], c[(i+2)%N]);
+    cw  = cw  || (o == Orient::CW);
+    ccw = ccw || (o == Orient::CCW);
+  }
+
+  return !(cw && ccw);
+}
+
+/***********************************************************
+* Index of the lowest node of a polygon, the leftmost one
+* among equally low nodes
+***********************************************************/
+static int lowest(const std::vector<Vec2r>& c)
+{
+  int k = 0;
+  for (int i = 1; i < c.size(); ++i)
+    if ( c[i][1] < c[k][1] || (c[i][1] == c[k][1] && c[i][0] < c[k][0]) )
+      k = i;
+  return k;
+}
+
+/***********************************************************
+* Function to compute the Minkowski sum of two convex
+* polygons. The counter-clockwise ordering of the shapes
+* turns clockwise in mathematical coordinates, where the
+* edges of both polygons are merged by their descending
+* angles.
+***********************************************************/
+std::vector<Vec2r> minkowski_sum(const std::vector<Vec2r>& a,
+                                 const std::vector<Vec2r>& b)
+{
+  int Na = a.size();
+  int Nb = b.size();
+
+  std::vector<Vec2r> sum;
+  if (Na == 0 || Nb == 0)
+    return sum;
+
+  sum.reserve(Na + Nb);
+
+  int ia = lowest(a);
+  int ib = lowest(b);
+  int i = 0, j = 0;
+
+  while (i < Na || j < Nb)
+  {
+    sum.push_back( a[(ia+i)%Na] + b[(ib+j)%Nb] );
+
+    Vec2r ea = a[(ia+i+1)%Na] - a[(ia+i)%Na];
+    Vec2r eb = b[(ib+j+1)%Nb] - b[(ib+j)%Nb];
+    Real  c  = cross(ea, eb);
+
+    if (j == Nb || (i < Na && c < 0.0f))
+      ++i;
+    else if (i == Na || c > 0.0f)
+      ++j;
+    else
+    {
+      ++i;
+      ++j;
+    }
+  }
+
+  return sum;
+}
+
+/***********************************************************
+* Function to check if two convex polygons are apart
+***********************************************************/
+bool convex_apart(const std::vector<Vec2r>& a,
+                  const std::vector<Vec2r>& b)
+{
+  if (a.size() < 3 || b.size() < 3)
+    return false;
+
+  std::vector<Vec2r> nb(b.size());
+  for (int i = 0; i < b.size(); ++i)
+    nb[i] = -b[i];
+
+  std::vector<Vec2r> m = minkowski_sum(a, nb);
+  Vec2r origin { 0.0f, 0.0f };
+
+  int N = m.size();
+  for (int i = 0; i < N; ++i)
+    if (orientation(m[i], m[(i+1)%N], origin) == Orient::CW)
+      return true;
+
+  return false;
+}
+
+/***********************************************************
+* Function to decompose a triangulated polygon into convex
+* parts (Hertel-Mehlhorn).
+*
+* The triangles are stored as half-edges, where 3k+i runs
+* from node i to node i+1 of triangle k. Triangles have a
+* positive area, so that the parts turn counter-clockwise
+* in mathematical coordinates until they are reversed at
+* the end.
+***********************************************************/
+std::vector<std::vector<Vec2r>>
+convex_decomposition(const Triangulation& t, Real tolerance)
+{
+  TRACE_ZONE("convex_decomposition");
+
+  const std::vector<Vec2r>& v = t.vertices;
+  int Nt = t.triangles.size();
+  int Nh = 3 * Nt;
+
+  std::vector<int> from(Nh), next(Nh), prev(Nh), twin(Nh, -1);
+  std::vector<bool> removed(Nh, false);
+
+  std::unordered_map<uint64_t, int> edges;
+  edges.reserve(Nh);
+
+  auto key = [](int a, int b)
+  { return (uint64_t(uint32_t(a)) << 32) | uint32_t(b); };
+
+  for (int k = 0; k < Nt; ++k)
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      int h = 3*k + i;
+      from[h] = t.triangles[k][i];
+      next[h] = 3*k + (i+1) % 3;
+      prev[h] = 3*k + (i+2) % 3;
+      edges[key(from[h], t.triangles[k][(i+1)%3])] = h;
+    }
+  }
+
+  for (int h = 0; h < Nh; ++h)
+  {
+    auto it = edges.find( key(from[next[h]], from[h]) );
+    if (it != edges.end())
+      twin[h] = it->second;
+  }
+
+  // True, if node b is convex between a and c
+  auto convex = [&](int a, int b, int c)
+  {
+    Vec2d p  { v[a][0], v[a][1] };
+    Vec2d q  { v[c][0], v[c][1] };
+    Vec2d r  { v[b][0], v[b][1] };
+    double l = (q - p).length();
+    return cross(q - p, r - p) <= tolerance * l;
+  };
+
+  /*--------------------------------------------------------
+  | Remove the diagonal (a,b) of half-edges h and g, if the
+  | nodes a and b stay convex
+  --------------------------------------------------------*/
+  for (int h = 0; h < Nh; ++h)
+  {
+    int g = twin[h];
+    if (g < h || removed[h])
+      continue;
+
+    int a = from[h];
+    int b = from[g];
+
+    if ( !convex(from[prev[h]], a, from[next[next[g]]]) ||
+         !convex(from[prev[g]], b, from[next[next[h]]]) )
+      continue;
+
+    next[prev[h]] = next[g];
+    prev[next[g]] = prev[h];
+    next[prev[g]] = next[h];
+    prev[next[h]] = prev[g];
+
+    removed[h] = removed[g] = true;
+  }
+
+  /*--------------------------------------------------------
+  | Collect the parts along their remaining half-edges
+  --------------------------------------------------------*/
+  std::vector<std::vector<Vec2r>> parts;
+  std::vector<bool> visited(Nh, false);
+
+  for (int h = 0; h < Nh; ++h)
+  {
+    if (removed[h] || visited[h])
+      continue;
+
+    std::vector<Vec2r> c;
+    for (int e = h; !visited[e]; e = next[e])
+    {
+      visited[e] = true;
+      c.push_back(v[from[e]]);
+    }
+
+    std::reverse(c.begin(), c.end());
+    parts.push_back(std::move(c));
+  }
+
+  return parts;
+}
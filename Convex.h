@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+#include "Vec2.h"
+#include "Triangulation.h"
+
+/***********************************************************
+* Convex polygons.
+*
+* All polygons are ordered counter-clockwise like the
+* shapes, such that their inside lies left of their edges.
+***********************************************************/
+
+/***********************************************************
+* Convex hull of a set of points in O(n log n) (monotone
+* chain). The points are sorted along x and the lower and
+* upper hull are built with a stack each, which drops
+* nodes that do not turn counter-clockwise. The hull has
+* no collinear nodes, it consists of less than three nodes
+* if all points lie on a line.
+***********************************************************/
+std::vector<Vec2r> convex_hull(std::vector<Vec2r> points);
+
+// True, if the closed polygon c turns in one direction only
+bool is_convex(const std::vector<Vec2r>& c);
+
+/***********************************************************
+* Minkowski sum of the convex polygons a and b in O(n+m).
+* Both polygons start at their lowest node and their edges
+* are merged in the order of their directions.
+***********************************************************/
+std::vector<Vec2r> minkowski_sum(const std::vector<Vec2r>& a,
+                                 const std::vector<Vec2r>& b);
+
+/***********************************************************
+* True, if the convex polygons a and b are apart from each
+* other. This is the case, if the origin lies outside of
+* their Minkowski difference a + (-b). Touching polygons
+* are not apart.
+***********************************************************/
+bool convex_apart(const std::vector<Vec2r>& a,
+                  const std::vector<Vec2r>& b);
+
+/***********************************************************
+* Decomposition of a triangulated polygon into convex parts
+* in O(n) (Hertel-Mehlhorn). Diagonals of the triangulation
+* are removed, as long as the nodes at both of their ends
+* stay convex. This leads to at most four times the minimal
+* number of parts.
+*
+* Nodes, that deviate less than tolerance from the edge
+* between their neighbors, count as convex, such that
+* nearly convex parts are merged as well.
+***********************************************************/
+std::vector<std::vector<Vec2r>>
+convex_decomposition(const Triangulation& t, Real tolerance = 0.0f);
@@ -7,10 +7,16 @@
 ***********************************************************/
 void Cursor::update()
 {
-  Vec2f& mouse_coords = space_.mouse_coords(); 
+  Vec2r& mouse_coords = space_.mouse_coords(); 
   float spacing = space_.grid().spacing();
   coords_[0] = spacing * round(mouse_coords[0]/spacing);
   coords_[1] = spacing * round(mouse_coords[1]/spacing);
+
+  // Snap to nearby nodes and edges
+  snap_target_ = space_.snap(mouse_coords, 
+                             snap_radius_ / space_.scale());
+  if (snap_target_.type != SnapType::Grid)
+    coords_ = snap_target_.coords;
 }
 
 
@@ -21,5 +27,43 @@ void Cursor::draw()
 {
   int sx, sy;
   space_.coord_to_screen(coords_, sx, sy);
-  space_.DrawCircle(sx, sy, size_, olc::YELLOW);
+  space_.renderer().draw_circle(sx, sy, size_, olc::YELLOW);
+
+  // Marker of the snap target: a square at nodes, a cross
+  // at intersections, a triangle at midpoints and an 
+  // hourglass on edges
+  TileRenderer& r = space_.renderer();
+  int d = size_ + 3;
+  olc::Pixel c = olc::MAGENTA;
+
+  switch (snap_target_.type)
+  {
+  case SnapType::Node:
+    r.draw_line(sx-d, sy-d, sx+d, sy-d, c);
+    r.draw_line(sx+d, sy-d, sx+d, sy+d, c);
+    r.draw_line(sx+d, sy+d, sx-d, sy+d, c);
+    r.draw_line(sx-d, sy+d, sx-d, sy-d, c);
+    break;
+
+  case SnapType::Intersection:
+    r.draw_line(sx-d, sy-d, sx+d, sy+d, c);
+    r.draw_line(sx-d, sy+d, sx+d, sy-d, c);
+    break;
+
+  case SnapType::Midpoint:
+    r.draw_line(sx-d, sy+d, sx+d, sy+d, c);
+    r.draw_line(sx+d, sy+d, sx,   sy-d, c);
+    r.draw_line(sx,   sy-d, sx-d, sy+d, c);
+    break;
+
+  case SnapType::Edge:
+    r.draw_line(sx-d, sy-d, sx+d, sy-d, c);
+    r.draw_line(sx+d, sy-d, sx-d, sy+d, c);
+    r.draw_line(sx-d, sy+d, sx+d, sy+d, c);
+    r.draw_line(sx+d, sy+d, sx-d, sy-d, c);
+    break;
+
+  default:
+    break;
+  }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Vec2.h"
+#include "Snap.h"
 
 class ModelSpace;
 
@@ -16,12 +17,18 @@ public:
   void update();
   void draw();
 
-  Vec2f& coords() { return coords_; }
+  Vec2r& coords() { return coords_; }
+  const SnapTarget& snap_target() const { return snap_target_; }
 
 private:
 
   ModelSpace&   space_;
-  Vec2f         coords_     = {0.0f, 0.0f}; 
+  Vec2r         coords_     = {0.0f, 0.0f}; 
   int           size_       = 3;
 
+  // Objects within this distance in pixels are preferred
+  // over the grid
+  int           snap_radius_ = 8;
+  SnapTarget    snap_target_;
+
 };
\ No newline at end of file
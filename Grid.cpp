@@ -25,8 +25,8 @@ void Grid::update()
 void Grid::draw()
 {
   // Get coordinates of visible screen
-  Vec2f top_left;
-  Vec2f bottom_right;
+  Vec2r top_left;
+  Vec2r bottom_right;
   space_.screen_to_coord(0, 0, top_left);
   space_.screen_to_coord(space_.ScreenWidth(), 
                          space_.ScreenHeight(), 
@@ -41,23 +41,29 @@ void Grid::draw()
   // Draw dots
   int sx, sy;
   int ex, ey;
-  for (float x = top_left[0]; x < bottom_right[0]; x += spacing_)
+  // Counted loops, since adding the spacing to coordinates
+  // far from the origin may not change them
+  int nx = int( (bottom_right[0] - top_left[0]) / spacing_ );
+  int ny = int( (bottom_right[1] - top_left[1]) / spacing_ );
+
+  for (int i = 0; i <= nx; ++i)
   {
-    for (float y = top_left[1]; y < bottom_right[1]; y += spacing_)
+    for (int j = 0; j <= ny; ++j)
     {
-      space_.coord_to_screen( {x, y}, sx, sy);
-      space_.Draw(sx, sy, olc::WHITE);
+      space_.coord_to_screen( { top_left[0] + i * spacing_, 
+                                top_left[1] + j * spacing_ }, sx, sy);
+      space_.renderer().draw(sx, sy, olc::WHITE);
     }
   }
 
   // Draw axis
   space_.coord_to_screen( { 0, top_left[1]}, sx, sy);
   space_.coord_to_screen( { 0, bottom_right[1]}, ex, ey);
-  space_.DrawLine(sx, sy, ex, ey, olc::GREY, 0xF0F0F0F0);
+  space_.renderer().draw_line(sx, sy, ex, ey, olc::GREY, 0xF0F0F0F0);
 
   space_.coord_to_screen( { top_left[0], 0}, sx, sy);
   space_.coord_to_screen( { bottom_right[0], 0}, ex, ey);
-  space_.DrawLine(sx, sy, ex, ey, olc::GREY, 0xF0F0F0F0);
+  space_.renderer().draw_line(sx, sy, ex, ey, olc::GREY, 0xF0F0F0F0);
 
 
 }
\ No newline at end of file
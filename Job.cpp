@@ -0,0 +1,59 @@
+#include "Job.h"
+#include "Shape.h"
+
+/***********************************************************
+* Destructor: frees results that were never committed
+***********************************************************/
+Job::~Job()
+{
+  for (auto s : results_)
+    delete s;
+}
+
+/***********************************************************
+* Function to execute the job on the calling thread
+***********************************************************/
+void Job::run()
+{
+  if (!cancelled())
+    results_ = work_(*this);
+
+  progress(1.0f);
+  done_.store(true, std::memory_order_release);
+}
+
+/***********************************************************
+* Function to hand over the resulting shapes
+***********************************************************/
+std::vector<Shape*> Job::take_results()
+{
+  std::vector<Shape*> results;
+  results.swap(results_);
+  return results;
+}
+
+/***********************************************************
+* Destructor: cancels all jobs and waits for them to stop
+***********************************************************/
+JobQueue::~JobQueue()
+{
+  for (auto& job : jobs_)
+    job->cancel();
+
+  if (!running_.done())
+    TaskPool::instance().wait(running_);
+}
+
+/***********************************************************
+* Function to submit a new job
+***********************************************************/
+std::shared_ptr<Job> JobQueue::submit(const std::string& name,
+                                      Job::Work work)
+{
+  std::shared_ptr<Job> job = std::make_shared<Job>(name, work);
+  jobs_.push_back(job);
+
+  TaskPool::instance().submit([job]() { job->run(); }, &running_);
+
+  return job;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TaskPool.h"
+
+class Shape;
+
+/***********************************************************
+* Progress and cancellation state of a running operation.
+* Long running geometry functions accept a pointer to this
+* class, to report their progress and to stop early.
+***********************************************************/
+class JobControl
+{
+public:
+  void cancel() { cancelled_ = true; }
+  bool cancelled() const { return cancelled_; }
+
+  void progress(float p) { progress_ = p; }
+  float progress() const { return progress_; }
+
+private:
+  std::atomic<bool>  cancelled_ { false };
+  std::atomic<float> progress_  { 0.0f };
+};
+
+/***********************************************************
+* A geometry operation, which is executed on a worker
+* thread. The work function operates on snapshots of the
+* involved shapes and returns the new shapes, which are
+* committed to the model space on the main thread.
+***********************************************************/
+class Job : public JobControl
+{
+public:
+  using Work = std::function<std::vector<Shape*>(JobControl&)>;
+
+  Job(const std::string& name, Work work)
+  : name_{name}, work_{work} {}
+  ~Job();
+
+  void run();
+
+  const std::string& name() const { return name_; }
+  bool done() const { return done_.load(std::memory_order_acquire); }
+
+  // Hand over the resulting shapes to the caller
+  std::vector<Shape*> take_results();
+
+private:
+  std::string         name_;
+  Work                work_;
+  std::vector<Shape*> results_;
+  std::atomic<bool>   done_ { false };
+};
+
+/***********************************************************
+* Queue of geometry jobs, which are processed on the shared
+* task pool. Results are committed in the order of 
+* submission.
+* The queue itself must only be accessed from the main
+* thread.
+***********************************************************/
+class JobQueue
+{
+public:
+  JobQueue() {}
+  ~JobQueue();
+
+  std::shared_ptr<Job> submit(const std::string& name, Job::Work work);
+
+  // Oldest job, that has not been committed yet
+  std::shared_ptr<Job> front()
+  { return jobs_.empty() ? nullptr : jobs_.front(); }
+  void pop() { jobs_.pop_front(); }
+
+  bool busy() const { return !jobs_.empty(); }
+
+private:
+  std::deque<std::shared_ptr<Job>>  jobs_;
+  TaskGroup                         running_;
+};
@@ -0,0 +1,1019 @@
+#include "Mesh.h"
+#include "ModelSpace.h"
+#include "Shape.h"
+#include "SizeField.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <deque>
+
+/***********************************************************
+* Limits of the mesh generation
+***********************************************************/
+static constexpr int    max_vertices = 1 << 20;
+static constexpr double eps          = 1.0e-9;
+
+/***********************************************************
+* Geometric predicates
+***********************************************************/
+// Twice the signed area of the triangle abc
+static inline double orient(const Vec2d& a, const Vec2d& b,
+                            const Vec2d& c)
+{
+  return (b[0]-a[0])*(c[1]-a[1]) - (b[1]-a[1])*(c[0]-a[0]);
+}
+
+// True, if d lies inside the circumcircle of the
+// counter-clockwise triangle abc
+static inline bool in_circle(const Vec2d& a, const Vec2d& b,
+                             const Vec2d& c, const Vec2d& d)
+{
+  double adx = a[0]-d[0], ady = a[1]-d[1];
+  double bdx = b[0]-d[0], bdy = b[1]-d[1];
+  double cdx = c[0]-d[0], cdy = c[1]-d[1];
+
+  double ad = adx*adx + ady*ady;
+  double bd = bdx*bdx + bdy*bdy;
+  double cd = cdx*cdx + cdy*cdy;
+
+  double det = adx * (bdy*cd - bd*cdy)
+             - ady * (bdx*cd - bd*cdx)
+             + ad  * (bdx*cdy - bdy*cdx);
+
+  // Tolerance for (nearly) co-circular points
+  double scale = ad + bd + cd;
+  return det > 1.0e-12 * scale * scale;
+}
+
+static inline Vec2d circumcenter(const Vec2d& a, const Vec2d& b,
+                                 const Vec2d& c)
+{
+  double bx = b[0]-a[0], by = b[1]-a[1];
+  double cx = c[0]-a[0], cy = c[1]-a[1];
+  double b2 = bx*bx + by*by;
+  double c2 = cx*cx + cy*cy;
+  double d  = 2.0 * (bx*cy - by*cx);
+
+  return { a[0] + (cy*b2 - by*c2) / d, a[1] + (bx*c2 - cx*b2) / d };
+}
+
+// True, if the segments ab and cd cross in their interiors
+static inline bool crossing(const Vec2d& a, const Vec2d& b,
+                            const Vec2d& c, const Vec2d& d)
+{
+  return orient(a, b, c) * orient(a, b, d) < 0.0
+      && orient(c, d, a) * orient(c, d, b) < 0.0;
+}
+
+/***********************************************************
+* Function to remove all vertices and triangles
+***********************************************************/
+void Mesh::clear()
+{
+  verts_.clear();
+  vert_he_.clear();
+  tri_.clear();
+  twin_.clear();
+  fixed_.clear();
+  inside_.clear();
+  last_       = 0;
+  n_elements_ = 0;
+}
+
+/***********************************************************
+* Function to add a triangle without neighbors
+***********************************************************/
+int Mesh::add_triangle(int a, int b, int c)
+{
+  int t = tri_.size() / 3;
+
+  tri_.insert(tri_.end(), {a, b, c});
+  twin_.insert(twin_.end(), {-1, -1, -1});
+  fixed_.insert(fixed_.end(), {0, 0, 0});
+  inside_.push_back(0);
+
+  return t;
+}
+
+/***********************************************************
+* Function to add a vertex without triangles
+***********************************************************/
+int Mesh::add_vertex(const Vec2d& p)
+{
+  verts_.push_back(p);
+  vert_he_.push_back(-1);
+  return verts_.size() - 1;
+}
+
+/***********************************************************
+* Function to connect two opposite half-edges
+***********************************************************/
+void Mesh::link(int a, int b)
+{
+  if (a >= 0) twin_[a] = b;
+  if (b >= 0) twin_[b] = a;
+}
+
+/***********************************************************
+* Function to update the outgoing half-edges of the
+* vertices of a modified triangle
+***********************************************************/
+void Mesh::update_vertices(int t)
+{
+  for (int h = 3*t; h < 3*t+3; ++h)
+    vert_he_[tri_[h]] = h;
+}
+
+/***********************************************************
+* Function to find the triangle, that contains point p.
+* Walks from the triangle start towards p.
+***********************************************************/
+int Mesh::locate(const Vec2d& p, int start)
+{
+  int t = start;
+  int N = number_of_triangles();
+
+  for (int step = 0; step < N; ++step)
+  {
+    int next_t = -1;
+
+    // Rotate the first edge to prevent cycles
+    for (int k = 0; k < 3; ++k)
+    {
+      int h = 3*t + (k + step) % 3;
+      if ( twin_[h] >= 0 &&
+           orient(verts_[tri_[h]], verts_[tri_[next(h)]], p) < 0.0 )
+      {
+        next_t = twin_[h] / 3;
+        break;
+      }
+    }
+
+    if (next_t < 0)
+      return t;
+
+    t = next_t;
+  }
+
+  // Fallback for degenerate walks
+  for (t = 0; t < N; ++t)
+  {
+    const Vec2d& a = verts_[tri_[3*t]];
+    const Vec2d& b = verts_[tri_[3*t+1]];
+    const Vec2d& c = verts_[tri_[3*t+2]];
+    if (orient(a,b,p) >= 0.0 && orient(b,c,p) >= 0.0 &&
+        orient(c,a,p) >= 0.0)
+      return t;
+  }
+
+  return -1;
+}
+
+/***********************************************************
+* Function to find the half-edge from vertex a to vertex b
+* Returns -1, if both vertices are not connected
+***********************************************************/
+int Mesh::find_edge(int a, int b)
+{
+  int start = vert_he_[a];
+  if (start < 0)
+    return -1;
+
+  // Rotate counter-clockwise around a
+  int h = start;
+  do
+  {
+    if (tri_[next(h)] == b)
+      return h;
+    h = twin_[prev(h)];
+  } while (h >= 0 && h != start);
+
+  if (h == start)
+    return -1;
+
+  // Rotate clockwise for vertices on the hull
+  h = start;
+  while (twin_[h] >= 0)
+  {
+    h = next(twin_[h]);
+    if (h == start)
+      break;
+    if (tri_[next(h)] == b)
+      return h;
+  }
+
+  return -1;
+}
+
+/***********************************************************
+* Function to insert a new vertex at point p and to restore
+* the Delaunay property.
+* Returns the index of the vertex, or of an existing vertex
+* at the same position.
+***********************************************************/
+int Mesh::insert_vertex(const Vec2d& p)
+{
+  int t = locate(p, last_);
+  if (t < 0)
+    return -1;
+
+  int on_edge = -1;
+
+  for (int h = 3*t; h < 3*t+3; ++h)
+  {
+    const Vec2d& a = verts_[tri_[h]];
+    const Vec2d& b = verts_[tri_[next(h)]];
+
+    if ( (p-a).length_squared() < eps*eps )
+      return tri_[h];
+
+    if ( std::fabs(orient(a, b, p)) < eps * (b-a).length() )
+      on_edge = h;
+  }
+
+  int v = add_vertex(p);
+
+  if (on_edge >= 0 && twin_[on_edge] >= 0)
+    split_edge(on_edge, v);
+  else
+    split_triangle(t, v);
+
+  return v;
+}
+
+/***********************************************************
+* Function to split triangle t at its inner vertex v
+***********************************************************/
+void Mesh::split_triangle(int t, int v)
+{
+  int h0 = 3*t, h1 = 3*t+1, h2 = 3*t+2;
+  int v0 = tri_[h0], v1 = tri_[h1], v2 = tri_[h2];
+
+  int  o1 = twin_[h1],  o2 = twin_[h2];
+  char f1 = fixed_[h1], f2 = fixed_[h2];
+
+  // t = (v0,v1,v), t1 = (v1,v2,v), t2 = (v2,v0,v)
+  int t1 = add_triangle(v1, v2, v);
+  int t2 = add_triangle(v2, v0, v);
+  tri_[h2] = v;
+
+  inside_[t1] = inside_[t2] = inside_[t];
+
+  link(3*t1, o1);
+  link(3*t2, o2);
+  fixed_[3*t1] = f1;
+  fixed_[3*t2] = f2;
+
+  link(h1, 3*t1+2);
+  link(3*t1+1, 3*t2+2);
+  link(3*t2+1, h2);
+  fixed_[h1] = fixed_[h2] = 0;
+
+  update_vertices(t);
+  update_vertices(t1);
+  update_vertices(t2);
+
+  last_ = t;
+
+  std::vector<int> stack { h0, 3*t1, 3*t2 };
+  legalize(stack);
+}
+
+/***********************************************************
+* Function to split the edge e and its twin at vertex v
+* Constraints are passed on to both parts of the edge.
+***********************************************************/
+void Mesh::split_edge(int e, int v)
+{
+  int f = twin_[e];
+  int e1 = next(e), e2 = prev(e);
+  int f1 = next(f), f2 = prev(f);
+
+  int u = tri_[e], w = tri_[e1], x = tri_[e2], z = tri_[f2];
+
+  char fc  = fixed_[e];
+  int  oe1 = twin_[e1],  of1 = twin_[f1];
+  char fe1 = fixed_[e1], ff1 = fixed_[f1];
+
+  // (u,v,x) + (v,w,x) on the side of e,
+  // (w,v,z) + (v,u,z) on the side of f
+  int A = add_triangle(v, w, x);
+  int B = add_triangle(v, u, z);
+  tri_[e1] = v;
+  tri_[f1] = v;
+
+  inside_[A] = inside_[e/3];
+  inside_[B] = inside_[f/3];
+
+  link(e, 3*B);
+  link(f, 3*A);
+  fixed_[e] = fixed_[3*B] = fixed_[f] = fixed_[3*A] = fc;
+
+  link(e1, 3*A+2);
+  link(f1, 3*B+2);
+  fixed_[e1] = fixed_[3*A+2] = fixed_[f1] = fixed_[3*B+2] = 0;
+
+  link(3*A+1, oe1);
+  link(3*B+1, of1);
+  fixed_[3*A+1] = fe1;
+  fixed_[3*B+1] = ff1;
+
+  update_vertices(e/3);
+  update_vertices(f/3);
+  update_vertices(A);
+  update_vertices(B);
+
+  last_ = A;
+
+  std::vector<int> stack { e2, 3*A+1, f2, 3*B+1 };
+  legalize(stack);
+}
+
+/***********************************************************
+* Function to flip the edge h, which is the diagonal of
+* a convex quadrilateral.
+* Afterwards, h and its twin form the edges, that follow
+* the new diagonal prev(h) in counter-clockwise direction.
+***********************************************************/
+void Mesh::flip(int a)
+{
+  int b  = twin_[a];
+  int ar = prev(a);
+  int bl = prev(b);
+
+  int p0 = tri_[ar];
+  int p1 = tri_[bl];
+
+  int  t_ar = twin_[ar],  t_bl = twin_[bl];
+  char f_ar = fixed_[ar], f_bl = fixed_[bl];
+
+  tri_[a] = p1;
+  tri_[b] = p0;
+
+  link(a, t_bl);
+  link(b, t_ar);
+  fixed_[a] = f_bl;
+  fixed_[b] = f_ar;
+
+  link(ar, bl);
+  fixed_[ar] = fixed_[bl] = 0;
+
+  update_vertices(a/3);
+  update_vertices(b/3);
+}
+
+/***********************************************************
+* Function to restore the Delaunay property after the
+* insertion of a vertex. The stack holds the edges
+* opposite of the new vertex.
+***********************************************************/
+void Mesh::legalize(std::vector<int>& stack)
+{
+  while (!stack.empty())
+  {
+    int a = stack.back();
+    stack.pop_back();
+
+    int b = twin_[a];
+    if (b < 0 || fixed_[a])
+      continue;
+
+    int p0 = tri_[prev(a)];
+    int pr = tri_[a];
+    int pl = tri_[next(a)];
+    int p1 = tri_[prev(b)];
+
+    if (!in_circle(verts_[pr], verts_[pl], verts_[p0], verts_[p1]))
+      continue;
+
+    int br = next(b);
+    flip(a);
+
+    stack.push_back(a);
+    stack.push_back(br);
+  }
+}
+
+/***********************************************************
+* Function to enforce the segment between vertices a and b.
+* Crossing edges are flipped away (Sloan), vertices on the
+* segment split it into several constraints.
+***********************************************************/
+void Mesh::insert_segment(int a, int b)
+{
+  std::vector<std::pair<int,int>> segments { {a, b} };
+
+  while (!segments.empty())
+  {
+    int u = segments.back().first;
+    int v = segments.back().second;
+    segments.pop_back();
+
+    if (u == v)
+      continue;
+
+    // Segment is already an edge
+    int h = find_edge(u, v);
+    if (h >= 0)
+    {
+      fixed_[h]++;
+      if (twin_[h] >= 0)
+        fixed_[twin_[h]]++;
+      continue;
+    }
+
+    const Vec2d& U = verts_[u];
+    const Vec2d& V = verts_[v];
+
+    /*------------------------------------------------------
+    | Find the first crossed edge in the fan around u
+    ------------------------------------------------------*/
+    int end   = v;
+    int cross = -1;
+    int start = vert_he_[u];
+
+    h = start;
+    do
+    {
+      int x = tri_[next(h)];
+      int y = tri_[prev(h)];
+      double ox = orient(U, verts_[x], V);
+      double oy = orient(U, verts_[y], V);
+
+      if (ox == 0.0 && dot(verts_[x]-U, V-U) > 0.0)
+      {
+        end = x;
+        break;
+      }
+      if (ox > 0.0 && oy < 0.0)
+      {
+        cross = next(h);
+        break;
+      }
+      h = twin_[prev(h)];
+    } while (h >= 0 && h != start);
+
+    /*------------------------------------------------------
+    | March along the segment and collect crossed edges
+    ------------------------------------------------------*/
+    std::deque<std::pair<int,int>> crossed;
+    bool failed = false;
+
+    while (cross >= 0)
+    {
+      int o = twin_[cross];
+      if (o < 0 || fixed_[cross])
+      {
+        failed = true;
+        break;
+      }
+
+      int x = tri_[cross];
+      int y = tri_[next(cross)];
+      crossed.push_back( {x, y} );
+
+      int z = tri_[prev(o)];
+      if (z == v)
+        break;
+
+      double oz = orient(U, V, verts_[z]);
+      if (oz == 0.0)
+      {
+        end = z;
+        break;
+      }
+
+      // The twin runs from y to x, continue on the edge
+      // whose vertices lie on both sides of the segment
+      double ox = orient(U, V, verts_[x]);
+      cross = ((oz > 0.0) == (ox > 0.0)) ? prev(o) : next(o);
+    }
+
+    if (failed || (end == v && crossed.empty()))
+      continue;
+
+    if (end != v)
+      segments.push_back( {end, v} );
+
+    const Vec2d& E = verts_[end];
+
+    /*------------------------------------------------------
+    | Flip crossed edges until the segment is recovered
+    ------------------------------------------------------*/
+    std::vector<std::pair<int,int>> created;
+    int guard = 0;
+    int max_guard = 16 * (crossed.size() + 1) * (crossed.size() + 1);
+
+    while (!crossed.empty() && guard++ < max_guard)
+    {
+      std::pair<int,int> e = crossed.front();
+      crossed.pop_front();
+
+      int k = find_edge(e.first, e.second);
+      if (k < 0)
+        continue;
+
+      int p = tri_[prev(k)];
+      int q = tri_[prev(twin_[k])];
+
+      const Vec2d& X = verts_[e.first];
+      const Vec2d& Y = verts_[e.second];
+
+      // Only the diagonal of a convex quadrilateral is flipped
+      if (!crossing(verts_[p], verts_[q], X, Y))
+      {
+        crossed.push_back(e);
+        continue;
+      }
+
+      flip(k);
+
+      if (crossing(U, E, verts_[p], verts_[q]))
+        crossed.push_back( {p, q} );
+      else
+        created.push_back( {p, q} );
+    }
+
+    /*------------------------------------------------------
+    | Restore the Delaunay property of the new edges
+    ------------------------------------------------------*/
+    bool swapped = true;
+    guard = 0;
+
+    while (swapped && guard++ < 64)
+    {
+      swapped = false;
+
+      for (auto& e : created)
+      {
+        if ( (e.first == u && e.second == end) ||
+             (e.first == end && e.second == u) )
+          continue;
+
+        int k = find_edge(e.first, e.second);
+        if (k < 0 || fixed_[k] || twin_[k] < 0)
+          continue;
+
+        int p = tri_[prev(k)];
+        int q = tri_[prev(twin_[k])];
+
+        if (in_circle(verts_[e.first], verts_[e.second],
+                      verts_[p], verts_[q]) &&
+            crossing(verts_[p], verts_[q],
+                     verts_[e.first], verts_[e.second]))
+        {
+          flip(k);
+          e = {p, q};
+          swapped = true;
+        }
+      }
+    }
+
+    segments.push_back( {u, end} );
+  }
+}
+
+/***********************************************************
+* Function to mark the triangles inside of the domain.
+* Starting outside, every crossing of a ring toggles
+* between outside and inside.
+***********************************************************/
+void Mesh::classify()
+{
+  int N = number_of_triangles();
+
+  inside_.assign(N, 0);
+  std::vector<char> seen(N, 0);
+  std::vector<int>  queue { vert_he_[0] / 3 };
+  seen[queue[0]] = 1;
+
+  for (int i = 0; i < queue.size(); ++i)
+  {
+    int t = queue[i];
+
+    for (int h = 3*t; h < 3*t+3; ++h)
+    {
+      int o = twin_[h];
+      if (o < 0 || seen[o/3])
+        continue;
+
+      inside_[o/3] = inside_[t] ^ (fixed_[h] & 1);
+      seen[o/3] = 1;
+      queue.push_back(o/3);
+    }
+  }
+}
+
+/***********************************************************
+* Function to refine the mesh (Ruppert's algorithm).
+* Encroached boundary segments are split at their midpoints,
+* triangles that are too large or too skinny are split at
+* their circumcenters.
+***********************************************************/
+void Mesh::refine(double size)
+{
+  TRACE_ZONE("Mesh::refine");
+
+  double min_len2 = 0.01 * size * size;
+
+  // Target size at point p, limited to a tenth of the
+  // global size
+  auto target = [&](const Vec2d& p)
+  {
+    if (!field_)
+      return size;
+
+    double h = field_->size( {Real(p[0]), Real(p[1])} );
+    return maximum(0.1 * size, minimum(size, h));
+  };
+
+  std::deque<std::pair<int,int>>   segments;
+  std::deque<std::array<int,4>>    triangles;
+  std::vector<int>                 stamp;
+  int                              n_stamp = 0;
+
+  auto queue_triangle = [&](int t)
+  {
+    if (inside_[t])
+      triangles.push_back( {t, tri_[3*t], tri_[3*t+1], tri_[3*t+2]} );
+  };
+
+  // Queue the triangles and segments around a new vertex
+  auto queue_around = [&](int v)
+  {
+    int start = vert_he_[v];
+    int h = start;
+    do
+    {
+      queue_triangle(h/3);
+      if (fixed_[h])
+        segments.push_back( {v, tri_[next(h)]} );
+      if (fixed_[next(h)])
+        segments.push_back( {tri_[next(h)], tri_[prev(h)]} );
+      h = twin_[prev(h)];
+    } while (h >= 0 && h != start);
+  };
+
+  // Segments are encroached, if the apex of an adjacent
+  // triangle inside the domain lies in their diametral
+  // circle
+  auto encroached = [&](int h)
+  {
+    const Vec2d& a = verts_[tri_[h]];
+    const Vec2d& b = verts_[tri_[next(h)]];
+    double len2 = (b-a).length_squared();
+    bool domain = false;
+
+    if (len2 < min_len2)
+      return false;
+
+    for (int s : {h, twin_[h]})
+    {
+      if (s < 0 || !inside_[s/3])
+        continue;
+
+      domain = true;
+      const Vec2d& p = verts_[tri_[prev(s)]];
+      if (dot(a-p, b-p) < 0.0)
+        return true;
+    }
+
+    if (!domain)
+      return false;
+
+    double hs = target( (a + b) * 0.5 );
+    return len2 > 1.5 * hs * hs;
+  };
+
+  auto split_segment = [&](int h)
+  {
+    int v = add_vertex( (verts_[tri_[h]] + verts_[tri_[next(h)]]) * 0.5 );
+    split_edge(h, v);
+    queue_around(v);
+  };
+
+  // Find the triangle that contains point p by walking
+  // along a straight line from triangle t. If a segment is
+  // crossed, its half-edge is returned in seg.
+  auto walk = [&](int t, const Vec2d& p, int& seg)
+  {
+    Vec2d s = (verts_[tri_[3*t]] + verts_[tri_[3*t+1]]
+             + verts_[tri_[3*t+2]]) / 3.0;
+    int entry = -1;
+    seg = -1;
+
+    for (int step = 0; step < number_of_triangles(); ++step)
+    {
+      int exit = -1;
+
+      for (int h = 3*t; h < 3*t+3 && exit < 0; ++h)
+      {
+        if (h == entry)
+          continue;
+
+        const Vec2d& a = verts_[tri_[h]];
+        const Vec2d& b = verts_[tri_[next(h)]];
+        if (orient(a, b, p) >= 0.0)
+          continue;
+
+        double oa = orient(s, p, a);
+        double ob = orient(s, p, b);
+        if ( (oa <= 0.0 && ob >= 0.0) || (oa >= 0.0 && ob <= 0.0) )
+          exit = h;
+      }
+
+      if (exit < 0)
+        return t;
+
+      if (fixed_[exit] || twin_[exit] < 0)
+      {
+        seg = exit;
+        return -1;
+      }
+
+      entry = twin_[exit];
+      t = entry / 3;
+    }
+
+    return -1;
+  };
+
+  // Search the Delaunay cavity of point p for segments,
+  // which are encroached by p
+  auto encroached_by = [&](int t, const Vec2d& p)
+  {
+    stamp.resize(number_of_triangles(), 0);
+    ++n_stamp;
+
+    std::vector<int> cavity { t };
+    stamp[t] = n_stamp;
+
+    for (int i = 0; i < cavity.size(); ++i)
+    {
+      for (int h = 3*cavity[i]; h < 3*cavity[i]+3; ++h)
+      {
+        const Vec2d& a = verts_[tri_[h]];
+        const Vec2d& b = verts_[tri_[next(h)]];
+
+        if (fixed_[h])
+        {
+          if (dot(a-p, b-p) < 0.0 &&
+              (b-a).length_squared() >= min_len2)
+            return h;
+          continue;
+        }
+
+        int o = twin_[h];
+        if (o < 0 || stamp[o/3] == n_stamp)
+          continue;
+
+        int n = o/3;
+        if (in_circle(verts_[tri_[3*n]], verts_[tri_[3*n+1]],
+                      verts_[tri_[3*n+2]], p))
+        {
+          stamp[n] = n_stamp;
+          cavity.push_back(n);
+        }
+      }
+    }
+
+    return -1;
+  };
+
+  // Triangles are bad, if their circumradius exceeds the
+  // target size or the ratio of circumradius and shortest
+  // edge exceeds sqrt(2) (min. angle of about 20.7 deg)
+  auto bad = [&](int t)
+  {
+    const Vec2d& a = verts_[tri_[3*t]];
+    const Vec2d& b = verts_[tri_[3*t+1]];
+    const Vec2d& c = verts_[tri_[3*t+2]];
+
+    double la = (b-c).length_squared();
+    double lb = (c-a).length_squared();
+    double lc = (a-b).length_squared();
+    double area2 = orient(a, b, c);
+    double r2 = la * lb * lc / (4.0 * area2 * area2);
+    double lmin = minimum(la, minimum(lb, lc));
+    double h = target( (a + b + c) / 3.0 );
+
+    if (r2 > h * h / 3.0)
+      return true;
+
+    return lmin >= min_len2 && r2 > 2.0 * lmin;
+  };
+
+  for (int h = 0; h < tri_.size(); ++h)
+    if (fixed_[h] && (twin_[h] < 0 || h < twin_[h]))
+      segments.push_back( {tri_[h], tri_[next(h)]} );
+
+  for (int t = 0; t < number_of_triangles(); ++t)
+    queue_triangle(t);
+
+  while (verts_.size() < max_vertices)
+  {
+    /*------------------------------------------------------
+    | Split encroached segments first
+    ------------------------------------------------------*/
+    if (!segments.empty())
+    {
+      std::pair<int,int> s = segments.front();
+      segments.pop_front();
+
+      int h = find_edge(s.first, s.second);
+      if (h >= 0 && fixed_[h] && encroached(h))
+        split_segment(h);
+
+      continue;
+    }
+
+    if (triangles.empty())
+      break;
+
+    /*------------------------------------------------------
+    | Split bad triangles
+    ------------------------------------------------------*/
+    std::array<int,4> q = triangles.front();
+    triangles.pop_front();
+
+    int t = q[0];
+    if (tri_[3*t] != q[1] || tri_[3*t+1] != q[2] ||
+        tri_[3*t+2] != q[3] || !inside_[t] || !bad(t))
+      continue;
+
+    Vec2d c = circumcenter(verts_[q[1]], verts_[q[2]], verts_[q[3]]);
+
+    int seg;
+    int tc = walk(t, c, seg);
+
+    if (tc >= 0)
+      seg = encroached_by(tc, c);
+
+    if (seg >= 0)
+    {
+      // Split the segment instead and retry later
+      const Vec2d& a = verts_[tri_[seg]];
+      const Vec2d& b = verts_[tri_[next(seg)]];
+      if ((b-a).length_squared() >= min_len2 && twin_[seg] >= 0)
+      {
+        split_segment(seg);
+        queue_triangle(t);
+      }
+      continue;
+    }
+
+    if (tc < 0)
+      continue;
+
+    last_ = tc;
+    int n_verts = verts_.size();
+    int v = insert_vertex(c);
+
+    if (v >= n_verts)
+      queue_around(v);
+  }
+}
+
+/***********************************************************
+* Function to generate the mesh of a model space
+***********************************************************/
+void Mesh::generate(ModelSpace& space, double size,
+                    const SizeField* field)
+{
+  std::vector<std::vector<Vec2r>> rings;
+
+  for (auto shapes : {&space.extr_shapes(), &space.intr_shapes()})
+    for (auto s : *shapes)
+    {
+      if (!s->complete() || s->number_of_nodes() < 3)
+        continue;
+
+      rings.emplace_back();
+      for (int i = 0; i < s->number_of_nodes(); ++i)
+        rings.back().push_back(s->get_node(i)->coords());
+    }
+
+  generate(rings, size, field);
+}
+
+/***********************************************************
+* Function to generate the mesh of a set of rings
+***********************************************************/
+void Mesh::generate(const std::vector<std::vector<Vec2r>>& rings,
+                    double size, const SizeField* field)
+{
+  TRACE_ZONE("Mesh::generate");
+
+  clear();
+  field_ = field;
+
+  std::vector<Vec2d> points;
+  for (const auto& r : rings)
+    for (const auto& c : r)
+      points.push_back( {c[0], c[1]} );
+
+  if (points.size() < 3)
+    return;
+
+  /*--------------------------------------------------------
+  | Enclosing triangle
+  --------------------------------------------------------*/
+  Vec2d lo = points[0], hi = points[0];
+  for (const auto& p : points)
+  {
+    lo = bbox_min(lo, p);
+    hi = bbox_max(hi, p);
+  }
+
+  Vec2d  m = (lo + hi) * 0.5;
+  double d = maximum(1.0, maximum(hi[0]-lo[0], hi[1]-lo[1]));
+
+  verts_ = { {m[0] - 20.0*d, m[1] - 10.0*d},
+             {m[0] + 20.0*d, m[1] - 10.0*d},
+             {m[0],          m[1] + 20.0*d} };
+  vert_he_.assign(3, -1);
+  add_triangle(0, 1, 2);
+  update_vertices(0);
+
+  /*--------------------------------------------------------
+  | Insert the ring vertices in strips, such that
+  | successive vertices are close to each other
+  --------------------------------------------------------*/
+  int N = points.size();
+  int n_strips = maximum(1, int(std::sqrt(N / 4.0)));
+  double width = (hi[0] - lo[0]) / n_strips + eps;
+
+  std::vector<int> order(N);
+  std::vector<int> strip(N);
+  for (int i = 0; i < N; ++i)
+  {
+    order[i] = i;
+    strip[i] = int((points[i][0] - lo[0]) / width);
+  }
+
+  std::sort(order.begin(), order.end(), [&](int a, int b)
+  {
+    if (strip[a] != strip[b])
+      return strip[a] < strip[b];
+    return (strip[a] % 2) ? points[a][1] > points[b][1]
+                          : points[a][1] < points[b][1];
+  });
+
+  std::vector<int> ids(N);
+  for (int i : order)
+    ids[i] = insert_vertex(points[i]);
+
+  /*--------------------------------------------------------
+  | Insert the ring edges as constraints
+  --------------------------------------------------------*/
+  int offset = 0;
+  for (const auto& r : rings)
+  {
+    int M = r.size();
+    for (int i = 0; i < M; ++i)
+    {
+      int a = ids[offset + i];
+      int b = ids[offset + (i+1) % M];
+      if (a >= 0 && b >= 0)
+        insert_segment(a, b);
+    }
+    offset += M;
+  }
+
+  classify();
+
+  if (size > 0.0)
+    refine(size);
+
+  n_elements_ = 0;
+  for (char in : inside_)
+    n_elements_ += in;
+}
+
+/***********************************************************
+* Function to draw the edges of all triangles inside of
+* the domain
+***********************************************************/
+void Mesh::draw(ModelSpace& space)
+{
+  for (int h = 0; h < tri_.size(); ++h)
+  {
+    if (!inside_[h/3] || fixed_[h])
+      continue;
+
+    // Draw inner edges only once
+    int o = twin_[h];
+    if (o >= 0 && inside_[o/3] && o < h)
+      continue;
+
+    const Vec2d& a = verts_[tri_[h]];
+    const Vec2d& b = verts_[tri_[next(h)]];
+
+    int sx, sy, ex, ey;
+    space.coord_to_screen( {Real(a[0]), Real(a[1])}, sx, sy);
+    space.coord_to_screen( {Real(b[0]), Real(b[1])}, ex, ey);
+    space.renderer().draw_line(sx, sy, ex, ey, olc::DARK_CYAN);
+  }
+}
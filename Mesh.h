@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+
+#include "Vec2.h"
+
+class ModelSpace;
+class SizeField;
+
+/***********************************************************
+* Constrained Delaunay triangulation of the model domain,
+* which is the region inside of the exterior shapes and
+* outside of the interior shapes.
+*
+* The triangles are stored as half-edges in flat arrays:
+* half-edges 3t, 3t+1 and 3t+2 form triangle t, half-edge
+* h starts at vertex vertex(h) and runs counter-clockwise
+* (positive signed area) to vertex(next(h)).
+* twin(h) is the opposite half-edge of the adjacent
+* triangle or -1 at the hull.
+***********************************************************/
+class Mesh
+{
+public:
+  Mesh() {}
+  ~Mesh() {}
+
+  /*********************************************************
+  * Mesh generation
+  * The triangles are refined until their edges are about
+  * as long as the given size and no angle is smaller than
+  * about 20 degrees. An optional sizing field reduces the
+  * size near small features.
+  *********************************************************/
+  void generate(ModelSpace& space, double size,
+                const SizeField* field = nullptr);
+
+  // Rings are closed by their last node, the domain is the
+  // region enclosed by an odd number of rings
+  void generate(const std::vector<std::vector<Vec2r>>& rings,
+                double size, const SizeField* field = nullptr);
+
+  void clear();
+
+  /*********************************************************
+  * Drawing
+  *********************************************************/
+  void draw(ModelSpace& space);
+
+  /*********************************************************
+  * Setters / Getters
+  *********************************************************/
+  static int next(int h) { return h - h%3 + (h+1)%3; }
+  static int prev(int h) { return h - h%3 + (h+2)%3; }
+
+  int twin(int h) const { return twin_[h]; }
+  int vertex(int h) const { return tri_[h]; }
+  bool constrained(int h) const { return fixed_[h] > 0; }
+  bool inside(int t) const { return inside_[t]; }
+
+  const Vec2d& coords(int v) const { return verts_[v]; }
+
+  int number_of_vertices() const { return verts_.size(); }
+  int number_of_triangles() const { return tri_.size() / 3; }
+
+  // Number of triangles inside of the domain
+  int number_of_elements() const { return n_elements_; }
+
+private:
+  std::vector<Vec2d>  verts_;
+  std::vector<int>    vert_he_;   // Outgoing half-edge per vertex
+  std::vector<int>    tri_;
+  std::vector<int>    twin_;
+  std::vector<char>   fixed_;     // Number of constraining rings
+  std::vector<char>   inside_;
+  int                 last_       = 0;
+  int                 n_elements_ = 0;
+  const SizeField*    field_      = nullptr;
+
+  int  add_vertex(const Vec2d& p);
+  int  add_triangle(int a, int b, int c);
+  void link(int a, int b);
+  void update_vertices(int t);
+
+  int  locate(const Vec2d& p, int start);
+  int  find_edge(int a, int b);
+  int  insert_vertex(const Vec2d& p);
+  void split_edge(int h, int v);
+  void split_triangle(int t, int v);
+  void flip(int h);
+  void legalize(std::vector<int>& stack);
+
+  void insert_segment(int a, int b);
+  void classify();
+  void refine(double size);
+};
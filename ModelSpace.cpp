@@ -6,31 +6,64 @@
 #include "Polygon.h"
 
 #include "Menu.h"
+#include "Simplify.h"
+#include "Trace.h"
+#include "Validator.h"
+
+#include <fstream>
+#include <limits>
+#include <sstream>
 
 /***********************************************************
 * Constructor
 ***********************************************************/
 ModelSpace::ModelSpace() 
 : grid_{ Grid(*this) }, cursor_{ Cursor(*this) }, 
-  menu_{ MenuObject(*this) }, menu_manager_{ MenuManager(*this) } 
+  menu_{ MenuObject(*this) }, menu_manager_{ MenuManager(*this) },
+  renderer_(*this)
 {
   sAppName = "ModelSpace";
   init_main_menu();
 }
 
+/***********************************************************
+* Status bar suffix for the object under the cursor
+***********************************************************/
+static std::string snap_name(SnapType t)
+{
+  switch (t)
+  {
+    case SnapType::Node:         return " (node)";
+    case SnapType::Intersection: return " (intersection)";
+    case SnapType::Midpoint:     return " (midpoint)";
+    case SnapType::Edge:         return " (edge)";
+    default:                     return "";
+  }
+}
+
 /***********************************************************
 * Function to transform from coordinate space to screen 
 ***********************************************************/
-void ModelSpace::coord_to_screen(const Vec2f& v, int& sx, int& sy)
+void ModelSpace::coord_to_screen(const Vec2r& v, int& sx, int& sy)
 {
   sx = (int) ((v[0]-offset_[0]) * scale_);
   sy = (int) ((v[1]-offset_[1]) * scale_);
 }
 
+/***********************************************************
+* Function to transform from coordinate to screen space 
+* without rounding to pixels
+***********************************************************/
+void ModelSpace::coord_to_screen(const Vec2r& v, Vec2f& s)
+{
+  s[0] = (v[0]-offset_[0]) * scale_;
+  s[1] = (v[1]-offset_[1]) * scale_;
+}
+
 /***********************************************************
 * Function to transform from screen to coordinate space 
 ***********************************************************/
-void ModelSpace::screen_to_coord(int sx, int sy, Vec2f& v)
+void ModelSpace::screen_to_coord(int sx, int sy, Vec2r& v)
 {
   v[0] = offset_[0] + (float)(sx) / scale_;
   v[1] = offset_[1] + (float)(sy) / scale_;
@@ -62,9 +95,9 @@ void ModelSpace::init_main_menu()
   // Exteriror Inserts
   MenuObject& menu_12 = menu_["main"]["Insert"]["Exterior"];
   menu_12["Polygon"].callback(insert_extr_polygon_mode_cb);
-  menu_12["Square"].enabled(false);
-  menu_12["Rectangle"].enabled(false);
-  menu_12["Circle"].enabled(false);
+  menu_12["Square"].callback(insert_extr_square_mode_cb);
+  menu_12["Rectangle"].callback(insert_extr_rectangle_mode_cb);
+  menu_12["Circle"].callback(insert_extr_circle_mode_cb);
 
   // Interior Inserts
   MenuObject& menu_11 = menu_["main"]["Insert"]["Interior"];
@@ -75,13 +108,24 @@ void ModelSpace::init_main_menu()
 
   // Modifications
   MenuObject& menu_2 = menu_["main"]["Modify"];
+  menu_2["Select"].callback(select_cb);
   menu_2["Insert Node"].callback(insert_node_cb);
   menu_2["Move Node"].callback(move_node_cb);
   menu_2["Move Shape"].callback(move_shape_cb);
-  menu_2["Clip Shape"].callback(clip_shape_cb);
+  menu_2["Clip Shape"].enabled(false).callback(clip_shape_cb);
   menu_2["Merge Shapes"].callback(merge_shapes_cb);
+  menu_2["Offset Shape"].dimension(1,3);
+  menu_2["Offset Shape"]["Miter"].callback(offset_miter_cb);
+  menu_2["Offset Shape"]["Round"].callback(offset_round_cb);
+  menu_2["Offset Shape"]["Square"].callback(offset_square_cb);
   menu_2["Remove Node"].callback(remove_node_cb);
   menu_2["Remove Shape"].callback(remove_shape_cb);
+  menu_2["Simplify Shape"].callback(simplify_shape_cb);
+  menu_2["Simplify All"].callback(simplify_all_cb);
+  menu_2["Validate"].callback(validate_cb);
+  menu_2["Mesh"].callback(mesh_cb);
+  menu_2["Fill"].callback(fill_cb);
+  menu_2["Snap"].callback(snap_cb);
 
   menu_.build();
 }
@@ -109,65 +153,143 @@ void ModelSpace::update_main_menu()
 ***********************************************************/
 bool ModelSpace::OnUserUpdate(float fElapsedTime)
 {
+  TRACE_ZONE("OnUserUpdate");
+
+#ifdef PIXMODELER_PROFILE
+  // Toggle profiler overlay with F3
+  profiler_.begin_frame();
+  if (GetKey(olc::Key::F3).bPressed)
+    profiler_.toggle();
+#endif
+
   // Update view of model space
-  pan_and_zoom();
+  {
+    PROFILE_SCOPE(Input);
+    TRACE_ZONE("Input");
+    pan_and_zoom();
+  }
 
   // Update objects
-  grid_.update();
-  cursor_.update();
-  menu_manager_.update(&menu_["main"]);
-
-  switch (state_)
-  {
-  case UserState::InsertExtrPolygon:
-    insert_extr_polygon();
-    break;
-  case UserState::MoveNode:
-    move_node();
-    break;
-  case UserState::MoveShape:
-    move_shape();
-    break;
-  case UserState::RemoveNode:
-    remove_node();
-    break;
-  case UserState::RemoveShape:
-    remove_shape();
-    break;
-  case UserState::InsertNode:
-    insert_node();
-    break;
-  case UserState::MergeShapes:
-    merge_shapes();
-    break;
-  case UserState::ClipShape:
-    clip_shape();
-    break;
-
-  default:
-    break;
-  }
-
-
-  // Return to view mode
+  {
+    PROFILE_SCOPE(Grid);
+    TRACE_ZONE("Grid");
+    grid_.update();
+  }
+  {
+    PROFILE_SCOPE(Cursor);
+    TRACE_ZONE("Cursor");
+    cursor_.update();
+  }
+  {
+    PROFILE_SCOPE(Menu);
+    TRACE_ZONE("Menu");
+    menu_manager_.update(&menu_["main"]);
+  }
+
+  {
+    PROFILE_SCOPE(State);
+    TRACE_ZONE("State");
+
+    // Finish background jobs, edits are paused meanwhile
+    update_jobs();
+
+    if (!jobs_.busy())
+    {
+      switch (state_)
+      {
+      case UserState::InsertExtrPolygon:
+        insert_extr_polygon();
+        break;
+      case UserState::InsertExtrCircle:
+      case UserState::InsertExtrRectangle:
+      case UserState::InsertExtrSquare:
+        insert_extr_primitive();
+        break;
+      case UserState::MoveNode:
+        move_node();
+        break;
+      case UserState::MoveShape:
+        move_shape();
+        break;
+      case UserState::RemoveNode:
+        remove_node();
+        break;
+      case UserState::RemoveShape:
+        remove_shape();
+        break;
+      case UserState::InsertNode:
+        insert_node();
+        break;
+      case UserState::MergeShapes:
+        merge_shapes();
+        break;
+      case UserState::ClipShape:
+        clip_shape();
+        break;
+      case UserState::OffsetShape:
+        offset_shape();
+        break;
+      case UserState::Select:
+        select();
+        break;
+      case UserState::SimplifyShape:
+        simplify();
+        break;
+
+      default:
+        break;
+      }
+    }
+
+    update_mesh();
+  }
+
+
+  // Return to view mode and cancel background jobs
   if (GetKey(olc::Key::ESCAPE).bPressed)
   {
+    std::string cancelled;
+
+    while (jobs_.busy())
+    {
+      cancelled = jobs_.front()->name() + ": cancelled";
+      jobs_.front()->cancel();
+      jobs_.pop();
+    }
+
     reset();
 
     state_ = UserState::View;
-    last_action_   = "View";
+    last_action_   = cancelled.empty() ? "View" : cancelled;
 
   }
 
   // Draw
-  draw_background();
-  grid_.draw(); 
-  cursor_.draw(); 
-  draw_shapes();
+  renderer_.begin(GetDrawTarget());
+  {
+    PROFILE_SCOPE(DrawGrid);
+    TRACE_ZONE("DrawGrid");
+    draw_background();
+    grid_.draw(); 
+    cursor_.draw(); 
+  }
+  {
+    PROFILE_SCOPE(DrawShapes);
+    TRACE_ZONE("DrawShapes");
+    draw_shapes();
+  }
+  {
+    PROFILE_SCOPE(Render);
+    renderer_.end();
+  }
 
   // Draw and updatemenus
-  menu_manager_.draw({30, 30});
-  update_main_menu();
+  {
+    PROFILE_SCOPE(DrawMenu);
+    TRACE_ZONE("DrawMenu");
+    menu_manager_.draw({30, 30});
+    update_main_menu();
+  }
 
   // Draw selected node
   if (selected_node_)
@@ -180,11 +302,28 @@ bool ModelSpace::OnUserUpdate(float fElapsedTime)
   // Draw status bar
   DrawString(10, 10, 
     "X="+std::to_string(cursor_.coords()[0])
-    +", Y="+std::to_string(cursor_.coords()[1]),
+    +", Y="+std::to_string(cursor_.coords()[1])
+    +snap_name(cursor_.snap_target().type),
     olc::YELLOW, 1);
   DrawString(10, ScreenHeight() - 20, 
              last_action_, olc::YELLOW, 1);
 
+#ifdef PIXMODELER_TRACE
+  // Write timeline of the recorded frames with F4
+  if (GetKey(olc::Key::F4).bPressed)
+  {
+    if (trace::write("trace.json"))
+      last_action_ = "Trace written to trace.json";
+    else
+      last_action_ = "Failed to write trace.json";
+  }
+#endif
+
+#ifdef PIXMODELER_PROFILE
+  profiler_.end_frame();
+  profiler_.draw(*this);
+#endif
+
   return true;
 }
 
@@ -227,7 +366,7 @@ void ModelSpace::set_selected_node()
 /***********************************************************
 * Pick an existing shape at a coordinate c
 ***********************************************************/
-Shape* ModelSpace::pick_shape(const Vec2f& c, bool extr_shape)
+Shape* ModelSpace::pick_shape(const Vec2r& c, bool extr_shape)
 {
   Shape* picked_shape = nullptr;
   Node* tmp_node = nullptr;
@@ -264,12 +403,237 @@ Shape* ModelSpace::pick_shape(const Vec2f& c, bool extr_shape)
 
 }
 
+/***********************************************************
+* Add a completed shape to the model space 
+***********************************************************/
+void ModelSpace::add_shape(Shape* s)
+{
+  std::vector<Shape*>& shapes = s->exterior() ? extr_shapes_ 
+                                              : intr_shapes_;
+  s->index(shapes.size());
+  shapes.push_back(s);
+
+  s->color(olc::WHITE);
+  modified();
+}
+
+/***********************************************************
+* Function to load shapes from a model file. 
+* Every shape starts with a header line "exterior <N>" or 
+* "interior <N>", followed by N lines of node coordinates.
+* Circles and rectangles are given by a single line 
+* "exterior circle <x> <y> <r>" or 
+* "exterior rectangle <x0> <y0> <x1> <y1>".
+* Lines starting with '#' are ignored.
+* Duplicate and collinear nodes of polygons are removed.
+***********************************************************/
+bool ModelSpace::load(const std::string& file)
+{
+  std::ifstream in(file);
+  if (!in)
+    return false;
+
+  std::string line;
+  while (std::getline(in, line))
+  {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    std::istringstream header(line);
+    std::string type, kind;
+    if (!(header >> type >> kind))
+      return false;
+    if (type != "exterior" && type != "interior")
+      return false;
+
+    bool extr = (type == "exterior");
+    int index = extr ? extr_shapes_.size() : intr_shapes_.size();
+
+    // Primitives are stored by their parameters
+    if (kind == "circle" || kind == "rectangle")
+    {
+      Vec2r a, b;
+      Real r = 0.0f;
+      bool circle = (kind == "circle");
+
+      if (circle ? !(header >> a[0] >> a[1] >> r) || r <= 0.0f
+                 : !(header >> a[0] >> a[1] >> b[0] >> b[1]) ||
+                   a[0] == b[0] || a[1] == b[1])
+        return false;
+
+      if (circle)
+        add_shape(new Circle(*this, index, extr, a, r));
+      else
+        add_shape(new Rectangle(*this, index, extr, a, b));
+      continue;
+    }
+
+    int n_nodes = 0;
+    if (!(std::istringstream(kind) >> n_nodes) || n_nodes < 3)
+      return false;
+
+    Shape* s = new Polygon(*this, index, extr);
+
+    for (int i = 0; i < n_nodes; ++i)
+    {
+      Vec2r c;
+      if (!std::getline(in, line) ||
+          !(std::istringstream(line) >> c[0] >> c[1]) ||
+          !s->add_node(c))
+      {
+        delete s;
+        return false;
+      }
+    }
+
+    // Closing the shape also sets its orientation
+    s->add_node(s->get_node(0)->coords());
+
+    if (!s->complete())
+    {
+      delete s;
+      return false;
+    }
+
+    s->normalize();
+    add_shape(s);
+  }
+
+  return true;
+}
+
+/***********************************************************
+* Function to save all shapes to a model file
+***********************************************************/
+bool ModelSpace::save(const std::string& file)
+{
+  std::ofstream out(file);
+  if (!out)
+    return false;
+
+  // Coordinates are written with enough digits to be read
+  // back exactly
+  out.precision(std::numeric_limits<Real>::max_digits10);
+  out << "# PixModeler model\n";
+
+  for (auto shapes : {&extr_shapes_, &intr_shapes_})
+    for (auto s : *shapes)
+    {
+      out << (s->exterior() ? "exterior " : "interior ");
+
+      Parametric* p = dynamic_cast<Parametric*>(s);
+
+      if (p && p->parametric())
+      {
+        if (Circle* c = dynamic_cast<Circle*>(p))
+          out << "circle " << c->center()[0] << " " 
+              << c->center()[1] << " " << c->radius() << "\n";
+        else if (Rectangle* r = dynamic_cast<Rectangle*>(p))
+          out << "rectangle " 
+              << r->corner_min()[0] << " " << r->corner_min()[1] << " "
+              << r->corner_max()[0] << " " << r->corner_max()[1] << "\n";
+        continue;
+      }
+
+      out << s->number_of_nodes() << "\n";
+
+      for (int i = 0; i < s->number_of_nodes(); ++i)
+      {
+        Vec2r c = s->get_node(i)->coords();
+        out << c[0] << " " << c[1] << "\n";
+      }
+    }
+
+  return bool(out);
+}
+
+/***********************************************************
+* Function to fit the view onto all shapes for a screen 
+* of the given size
+***********************************************************/
+void ModelSpace::fit_view(int width, int height)
+{
+  Vec2r bb_min, bb_max;
+  bool found = false;
+
+  for (auto shapes : {&extr_shapes_, &intr_shapes_})
+    for (auto s : *shapes)
+    {
+      if (s->number_of_nodes() == 0)
+        continue;
+
+      Vec2r lo, hi;
+      s->bounding_box(lo, hi);
+      bb_min = found ? bbox_min(bb_min, lo) : lo;
+      bb_max = found ? bbox_max(bb_max, hi) : hi;
+      found = true;
+    }
+
+  Vec2r center = (bb_min + bb_max) * 0.5f;
+  Vec2r extent = bb_max - bb_min;
+
+  // Leave a margin of 10% around the shapes
+  scale_ = max_scale_;
+  if (extent[0] > 0.0f)
+    scale_ = minimum(scale_, float(0.9f * width / extent[0]));
+  if (extent[1] > 0.0f)
+    scale_ = minimum(scale_, float(0.9f * height / extent[1]));
+  scale_ = maximum(scale_, min_scale_);
+
+  offset_[0] = center[0] - 0.5f * width / scale_;
+  offset_[1] = center[1] - 0.5f * height / scale_;
+}
+
+/***********************************************************
+* Function to render the model into a sprite without 
+* initializing the platform or the renderer.
+* The view is fitted onto all shapes. 
+* Since the screen size is adjusted to the target, this 
+* must not be called on a running engine.
+***********************************************************/
+void ModelSpace::render_offscreen(olc::Sprite* target)
+{
+  Construct(target->width, target->height, 1, 1);
+
+  if (!offscreen_init_)
+  {
+    olc_ConstructFontSheet(false);
+    offscreen_init_ = true;
+  }
+
+  SetDrawTarget(target);
+  fit_view(target->width, target->height);
+
+  grid_.update();
+  renderer_.begin(target);
+  draw_background();
+  grid_.draw();
+  draw_shapes();
+  renderer_.end();
+}
+
+/***********************************************************
+* Function to render the model offscreen into a PNG file
+***********************************************************/
+bool ModelSpace::render_to_png(const std::string& file, 
+                               int width, int height)
+{
+  olc::Sprite target(width, height);
+  render_offscreen(&target);
+
+  return olc::Sprite::loader->SaveImageResource(&target, file) 
+         == olc::rcode::OK;
+}
+
 /***********************************************************
 * Reset temporary shapes
 ***********************************************************/
 void ModelSpace::reset()
 {
-  if (state_ == UserState::InsertExtrPolygon)
+  if (state_ == UserState::InsertExtrPolygon   ||
+      state_ == UserState::InsertExtrCircle    ||
+      state_ == UserState::InsertExtrRectangle ||
+      state_ == UserState::InsertExtrSquare)
     delete temp_shape_;
 
   if (temp_shape_)
@@ -277,6 +641,10 @@ void ModelSpace::reset()
 
   temp_shape_    = nullptr;
   selected_node_ = nullptr;
+
+  selection_.clear();
+  banding_  = false;
+  dragging_ = false;
 }
 
 /***********************************************************
@@ -297,12 +665,68 @@ void ModelSpace::insert_extr_polygon()
     {
       temp_shape_->color(olc::WHITE);
       extr_shapes_.push_back(temp_shape_);
+      modified();
       temp_shape_ = nullptr;
       selected_node_ = nullptr;
     }
   }
 }
 
+/***********************************************************
+* Function to insert exterior circles, rectangles and 
+* squares. The first click sets the center or a corner,
+* the shape follows the cursor until the second click.
+***********************************************************/
+void ModelSpace::insert_extr_primitive()
+{
+  Vec2r c = cursor_.coords();
+
+  if (temp_shape_ == nullptr)
+  {
+    if (!GetMouse(1).bReleased)
+      return;
+
+    anchor_ = c;
+    int index = extr_shapes_.size();
+
+    if (state_ == UserState::InsertExtrCircle)
+      temp_shape_ = new Circle(*this, index, true, c, 0.0f);
+    else if (state_ == UserState::InsertExtrRectangle)
+      temp_shape_ = new Rectangle(*this, index, true, c, c);
+    else
+      temp_shape_ = new Square(*this, index, true, c, c);
+
+    temp_shape_->color(olc::GREEN);
+    return;
+  }
+
+  // Follow the cursor
+  Vec2r d = c - anchor_;
+  bool degenerate = false;
+
+  if (state_ == UserState::InsertExtrCircle)
+  {
+    static_cast<Circle*>(temp_shape_)->set(anchor_, d.length());
+    degenerate = d.near_zero_length();
+  }
+  else if (state_ == UserState::InsertExtrRectangle)
+  {
+    static_cast<Rectangle*>(temp_shape_)->set(anchor_, c);
+    degenerate = (d[0] == 0.0f || d[1] == 0.0f);
+  }
+  else
+  {
+    static_cast<Square*>(temp_shape_)->set(anchor_, c);
+    degenerate = (d[0] == 0.0f && d[1] == 0.0f);
+  }
+
+  if (GetMouse(1).bReleased && !degenerate)
+  {
+    add_shape(temp_shape_);
+    temp_shape_ = nullptr;
+  }
+}
+
 /***********************************************************
 * Function to move existing nodes
 ***********************************************************/
@@ -316,7 +740,7 @@ void ModelSpace::move_node()
   else 
   {
     // Move node
-    Vec2f tmp_coords = selected_node_->coords();
+    Vec2r tmp_coords = selected_node_->coords();
     selected_node_->coords(cursor_.coords());
 
     // Check validity of new node
@@ -343,8 +767,8 @@ void ModelSpace::move_shape()
   else
   {
     // Move entire shape
-    Vec2f node_coords = selected_node_->coords();
-    Vec2f delta = cursor_.coords() - node_coords;
+    Vec2r node_coords = selected_node_->coords();
+    Vec2r delta = cursor_.coords() - node_coords;
     
     if (temp_shape_)
       temp_shape_->move(delta);
@@ -379,6 +803,8 @@ void ModelSpace::remove_shape()
       for (int i = index; i < extr_shapes_.size(); i++)
         extr_shapes_[i]->index(i);
 
+      modified();
+
       selected_node_ = nullptr;
       temp_shape_ = nullptr;
     }
@@ -449,10 +875,10 @@ void ModelSpace::insert_node()
 
     if (prev && next)
     {
-      Vec2f p = prev->coords();
-      Vec2f q = selected_node_->coords();
-      Vec2f r = next->coords();
-      Vec2f c = cursor_.coords();
+      Vec2r p = prev->coords();
+      Vec2r q = selected_node_->coords();
+      Vec2r r = next->coords();
+      Vec2r c = cursor_.coords();
 
       if (in_segment(p,q,c))
         temp_shape_->add_node(i_cur, c);
@@ -465,8 +891,164 @@ void ModelSpace::insert_node()
 
 }
 
+/***********************************************************
+* Function to commit the results of finished background 
+* jobs and to show the progress of running jobs
+***********************************************************/
+void ModelSpace::update_jobs()
+{
+  std::shared_ptr<Job> job = jobs_.front();
+
+  if (!job)
+    return;
+
+  if (job->done())
+  {
+    std::vector<Shape*> results = job->take_results();
+
+    for (auto s : results)
+      add_shape(s);
+
+    last_action_ = job->name() 
+                 + (results.empty() ? ": no result" : ": done");
+    jobs_.pop();
+  }
+  else
+  {
+    last_action_ = job->name() + ": " 
+                 + std::to_string(int(100 * job->progress()))
+                 + "% (ESC to cancel)";
+  }
+}
+
+/***********************************************************
+* Function to select nodes and shapes and to transform 
+* them together.
+* A band, which is spanned with the right mouse button, 
+* selects the nodes within, or their entire shapes while
+* CTRL is held. The selection is extended while SHIFT is 
+* held. Dragging a selected node moves the selection. 
+* R rotates by 15 degrees, S scales by 10 %, both in the
+* opposite direction with SHIFT, H and V mirror the
+* selection horizontally and vertically.
+***********************************************************/
+void ModelSpace::select()
+{
+  static constexpr float angle = 3.14159265358979f / 12.0f;
+
+  Vec2r c = cursor_.coords();
+  bool shift = GetKey(olc::Key::SHIFT).bHeld;
+
+  if (GetMouse(1).bPressed)
+  {
+    for (const auto& g : selection_.groups())
+      for (auto n : g.nodes)
+        if ( (c - n->coords()).length_squared() < 0.01f )
+          dragging_ = true;
+
+    if (dragging_)
+      drag_from_ = c;
+    else
+    {
+      banding_    = true;
+      band_start_ = c;
+    }
+  }
+
+  if (dragging_ && c != drag_from_)
+  {
+    if (selection_.translate(c - drag_from_))
+      drag_from_ = c;
+  }
+
+  if (GetMouse(1).bReleased)
+  {
+    if (banding_)
+    {
+      if (!shift)
+        selection_.clear();
+      select_band(band_start_, c, GetKey(olc::Key::CTRL).bHeld);
+    }
+
+    banding_  = false;
+    dragging_ = false;
+
+    last_action_ = "Select: " 
+                 + std::to_string(selection_.number_of_nodes()) 
+                 + " nodes in "
+                 + std::to_string(selection_.number_of_shapes()) 
+                 + " shapes";
+  }
+
+  if (selection_.empty() || dragging_)
+    return;
+
+  bool pressed = true;
+  bool applied = false;
+
+  // Positive angles turn clockwise on the screen
+  if (GetKey(olc::Key::R).bPressed)
+    applied = selection_.rotate(shift ? angle : -angle);
+  else if (GetKey(olc::Key::S).bPressed)
+    applied = selection_.scale(shift ? 1.0f / 1.1f : 1.1f);
+  else if (GetKey(olc::Key::H).bPressed)
+    applied = selection_.mirror(0);
+  else if (GetKey(olc::Key::V).bPressed)
+    applied = selection_.mirror(1);
+  else
+    pressed = false;
+
+  if (pressed && !applied)
+    last_action_ = "Select: a shape would become invalid";
+}
+
+/***********************************************************
+* Function to add the nodes within the box spanned by the
+* points a and b to the selection, or their entire shapes
+***********************************************************/
+void ModelSpace::select_band(const Vec2r& a, const Vec2r& b, 
+                             bool shapes)
+{
+  // Clicks select the nodes at the cursor
+  Vec2r lo = bbox_min(a, b) - Vec2r { 0.1f, 0.1f };
+  Vec2r hi = bbox_max(a, b) + Vec2r { 0.1f, 0.1f };
+
+  for (auto list : {&extr_shapes_, &intr_shapes_})
+    for (auto s : *list)
+      for (int i = 0; i < s->number_of_nodes(); ++i)
+      {
+        Node* n = s->get_node(i);
+        Vec2r p = n->coords();
+
+        if (p[0] < lo[0] || p[0] > hi[0] || 
+            p[1] < lo[1] || p[1] > hi[1])
+          continue;
+
+        if (shapes)
+        {
+          selection_.add(s);
+          break;
+        }
+
+        selection_.add(n);
+      }
+}
+
+/***********************************************************
+* Function returns true, if nodes of the shape are 
+* selected for editing
+***********************************************************/
+bool ModelSpace::editing(const Shape* s)
+{
+  if (selected_node_ && &selected_node_->parent() == s)
+    return true;
+
+  return selection_.contains(s);
+}
+
 /***********************************************************
 * Function to merge two shapes
+* The merge runs in the background on copies of both shapes
 ***********************************************************/
 void ModelSpace::merge_shapes()
 {
@@ -482,17 +1064,17 @@ void ModelSpace::merge_shapes()
 
     if (merge_shape)
     {
-      Shape* new_shape = temp_shape_->merge(merge_shape);
+      std::shared_ptr<Shape> a { temp_shape_->snapshot() };
+      std::shared_ptr<Shape> b { merge_shape->snapshot() };
 
-      if (new_shape)
+      jobs_.submit("Merge shapes", [a, b](JobControl& ctl)
       {
-        if (new_shape->exterior())
-          extr_shapes_.push_back(new_shape);
-        else 
-          intr_shapes_.push_back(new_shape);
-
-        new_shape->color(olc::WHITE);
-      }
+        std::vector<Shape*> new_shapes;
+        Shape* new_shape = a->merge(b.get(), &ctl);
+        if (new_shape)
+          new_shapes.push_back(new_shape);
+        return new_shapes;
+      });
       
       reset();
     }
@@ -516,41 +1098,207 @@ void ModelSpace::clip_shape()
     Shape* clip_shape = pick_shape(cursor_.coords(), 
                                    temp_shape_->exterior());
 
+    // Shape::clip() does not create any shapes yet, so no
+    // job is submitted until it does
     if (clip_shape)
     {
-      // temp_shape gets clipped on clip_shape
-      std::vector<Shape*> new_shapes = temp_shape_->clip(clip_shape);
-
-      if (new_shapes.size() > 0)
-      {
-        if (temp_shape_->exterior())
-          for (auto s : new_shapes)
-          {
-            extr_shapes_.push_back(s);
-            s->color(olc::WHITE);
-          }
-        else 
-          for (auto s : new_shapes)
-          {
-            intr_shapes_.push_back(s);
-            s->color(olc::WHITE);
-          }
-      }
-
-      std::cout << "CLIP\n";
-      
       reset();
+      last_action_ = "Clip shape: not supported yet";
     }
   }
 
 }
 
+/***********************************************************
+* Function to offset a shape
+* The distance is given by the cursor relative to the 
+* outline of the selected shape, which is inflated outside 
+* and deflated inside of it. The offset runs in the 
+* background on a copy of the shape, which is kept.
+***********************************************************/
+void ModelSpace::offset_shape()
+{
+  // Select shape / node
+  if (selected_node_ == nullptr)
+  {
+    set_selected_node();
+  }
+  else if (GetMouse(1).bReleased)
+  {
+    std::shared_ptr<Shape> a { temp_shape_->snapshot() };
+
+    Real distance = signed_distance(a->coords(), cursor_.coords());
+    Real max_error = Parametric::max_error / scale_;
+    JoinType join = offset_join_;
+
+    jobs_.submit("Offset shape", [a, distance, join, max_error]
+                                 (JobControl& ctl)
+    {
+      return a->offset(distance, join, max_error, &ctl);
+    });
+
+    reset();
+  }
+}
+
+/***********************************************************
+* Function to simplify the shape of a selected node. 
+* Nodes deviating less than simplify_error_ pixels at the 
+* current scale are removed.
+***********************************************************/
+void ModelSpace::simplify()
+{
+  set_selected_node();
+
+  if (selected_node_ == nullptr)
+    return;
+
+  Shape* s = temp_shape_;
+  int n_removed = simplify_shape(*this, s, simplify_error_ / scale_);
+
+  reset();
+
+  last_action_ = "Simplify: " + std::to_string(n_removed) 
+               + " nodes removed, " 
+               + std::to_string(s->number_of_nodes()) + " left";
+}
+
+/***********************************************************
+* Function to simplify all shapes
+***********************************************************/
+void ModelSpace::simplify_all()
+{
+  int n_removed = simplify_model(*this, simplify_error_ / scale_);
+
+  last_action_ = "Simplify: " + std::to_string(n_removed) 
+               + " nodes removed";
+}
+
+/***********************************************************
+* Function to validate all shapes 
+* Invalid and overlapping shapes are highlighted in red
+***********************************************************/
+void ModelSpace::validate()
+{
+  for (auto shapes : {&extr_shapes_, &intr_shapes_})
+    for (auto s : *shapes)
+      s->color(olc::WHITE);
+
+  std::vector<ValidationIssue> issues = validate_model(*this);
+
+  for (const auto& issue : issues)
+  {
+    std::vector<Shape*>& shapes = issue.exterior ? extr_shapes_
+                                                 : intr_shapes_;
+    shapes[issue.shape_a]->color(olc::RED);
+    shapes[issue.shape_b]->color(olc::RED);
+  }
+
+  if (issues.empty())
+    last_action_ = "Validate: no issues";
+  else
+    last_action_ = "Validate: " + std::to_string(issues.size()) 
+                 + " issues";
+}
+
+/***********************************************************
+* Function to show or hide the mesh of the domain
+***********************************************************/
+void ModelSpace::toggle_mesh()
+{
+  show_mesh_ = !show_mesh_;
+
+  if (!show_mesh_)
+  {
+    mesh_.clear();
+    mesh_revision_ = 0;
+    last_action_ = "Mesh: hidden";
+    return;
+  }
+
+  update_mesh();
+  last_action_ = "Mesh: " + std::to_string(mesh_.number_of_elements())
+               + " elements";
+}
+
+/***********************************************************
+* Function to show or hide the filled domain
+***********************************************************/
+void ModelSpace::toggle_fill()
+{
+  show_fill_ = !show_fill_;
+  last_action_ = show_fill_ ? "Fill: shown" : "Fill: hidden";
+}
+
+/***********************************************************
+* Function to toggle the object snapping of the cursor
+***********************************************************/
+void ModelSpace::toggle_snap()
+{
+  snap_enabled_ = !snap_enabled_;
+  last_action_ = snap_enabled_ ? "Snap: on" : "Snap: off";
+}
+
+/***********************************************************
+* Function returns the snap target around a point. The 
+* shape or node, that is currently moved, is excluded and
+* the polygon, that is currently inserted, is included.
+***********************************************************/
+SnapTarget ModelSpace::snap(const Vec2r& p, Real radius)
+{
+  // The selection would snap onto itself while dragged
+  if (!snap_enabled_ || dragging_)
+    return SnapTarget();
+
+  Shape* extra = (state_ == UserState::InsertExtrPolygon) 
+               ? temp_shape_ : nullptr;
+
+  // Every modification of a shape advances the revision
+  if (revision_ != snap_revision_ || extra != snap_extra_)
+  {
+    snap_index_.sync(*this, extra);
+    snap_revision_ = revision_;
+    snap_extra_    = extra;
+  }
+
+  const Shape* skip_shape = nullptr;
+  const Node*  skip_node  = nullptr;
+
+  if (state_ == UserState::MoveShape)
+    skip_shape = temp_shape_;
+  if (state_ == UserState::MoveNode)
+    skip_node = selected_node_;
+
+  return snap_index_.snap(p, radius, skip_shape, skip_node);
+}
+
+/***********************************************************
+* Function to regenerate the mesh, if the shapes or the
+* grid spacing have changed
+***********************************************************/
+void ModelSpace::update_mesh()
+{
+  if (!show_mesh_)
+    return;
+
+  if (mesh_revision_ == revision_ && mesh_size_ == grid_.spacing())
+    return;
+
+  TRACE_ZONE("update_mesh");
+
+  mesh_revision_ = revision_;
+  mesh_size_     = grid_.spacing();
+
+  size_field_.sync(*this);
+  mesh_.generate(*this, mesh_size_, &size_field_);
+}
+
 /***********************************************************
 * Function to pan and zoom the space coordinats 
 ***********************************************************/
 void ModelSpace::pan_and_zoom()
 {
-  Vec2f mouse = { (float)GetMouseX(), (float)GetMouseY() };
+  Vec2r mouse = { (float)GetMouseX(), (float)GetMouseY() };
 
   // Mouse panning
   if (GetMouse(0).bPressed)
@@ -564,7 +1312,7 @@ void ModelSpace::pan_and_zoom()
   }
 
   // Mouse zooming
-  Vec2f mouse_z_old, mouse_z_new;
+  Vec2r mouse_z_old, mouse_z_new;
   screen_to_coord((int)mouse[0], (int)mouse[1], mouse_z_old);
 
   if (GetKey(olc::Key::Q).bHeld || GetMouseWheel() > 0)
@@ -586,7 +1334,7 @@ void ModelSpace::pan_and_zoom()
 void ModelSpace::draw_background()
 {
   // Clear screen
-  Clear(olc::VERY_DARK_BLUE);
+  renderer_.clear(olc::VERY_DARK_BLUE);
 }
 
 /***********************************************************
@@ -594,6 +1342,23 @@ void ModelSpace::draw_background()
 ***********************************************************/
 void ModelSpace::draw_shapes()
 {
+  // Fill the domain below the mesh and the shapes. Interior
+  // shapes are reversed to cut holes into exterior shapes.
+  if (show_fill_)
+  {
+    raster_.clear();
+    for (auto s : extr_shapes_)
+      raster_.add_shape(*this, *s);
+    for (auto s : intr_shapes_)
+      raster_.add_shape(*this, *s, true);
+    renderer_.fill(raster_, olc::Pixel(0, 64, 96), 
+                   FillRule::NonZero);
+  }
+
+  // Draw mesh below the shapes
+  if (show_mesh_)
+    mesh_.draw(*this);
+
   // Draw current shape 
   if (temp_shape_ != nullptr)
   {
@@ -601,12 +1366,53 @@ void ModelSpace::draw_shapes()
     temp_shape_->draw_nodes();
   }
 
-  // Draw exterior shapes
+  // Draw exterior shapes, which are culled by their cached
+  // bounding boxes. The margin covers the node labels.
+  Vec2r view_lo, view_hi;
+  screen_to_coord(-48, -48, view_lo);
+  screen_to_coord(ScreenWidth() + 48, ScreenHeight() + 48, view_hi);
+
   for (auto s : extr_shapes_)
   {
+    Vec2r lo, hi;
+    s->bounding_box(lo, hi);
+
+    if ( hi[0] < view_lo[0] || lo[0] > view_hi[0] ||
+         hi[1] < view_lo[1] || lo[1] > view_hi[1] )
+      continue;
+
     s->draw();
     s->draw_nodes();
   }
+
+  draw_selection();
+}
+
+/***********************************************************
+* Function to highlight the selected nodes and to draw the
+* selection band
+***********************************************************/
+void ModelSpace::draw_selection()
+{
+  for (const auto& g : selection_.groups())
+    for (auto n : g.nodes)
+    {
+      int sx, sy;
+      coord_to_screen(n->coords(), sx, sy);
+      renderer_.fill_circle(sx, sy, 3, olc::YELLOW);
+    }
+
+  if (banding_)
+  {
+    int x0, y0, x1, y1;
+    coord_to_screen(band_start_, x0, y0);
+    coord_to_screen(cursor_.coords(), x1, y1);
+
+    renderer_.draw_line(x0, y0, x1, y0, olc::YELLOW, 0xF0F0F0F0);
+    renderer_.draw_line(x1, y0, x1, y1, olc::YELLOW, 0xF0F0F0F0);
+    renderer_.draw_line(x1, y1, x0, y1, olc::YELLOW, 0xF0F0F0F0);
+    renderer_.draw_line(x0, y1, x0, y0, olc::YELLOW, 0xF0F0F0F0);
+  }
 }
 
 /***********************************************************
@@ -619,6 +1425,30 @@ void insert_extr_polygon_mode_cb(ModelSpace& sp, MenuObject& mo)
   sp.last_action( "Insert exterior polygon" );
 }
 
+/***********************************************************
+* Callback functions for creation of exterior primitives
+***********************************************************/
+void insert_extr_circle_mode_cb(ModelSpace& sp, MenuObject& mo)
+{
+  sp.reset();
+  sp.state( UserState::InsertExtrCircle );
+  sp.last_action( "Insert exterior circle" );
+}
+
+void insert_extr_rectangle_mode_cb(ModelSpace& sp, MenuObject& mo)
+{
+  sp.reset();
+  sp.state( UserState::InsertExtrRectangle );
+  sp.last_action( "Insert exterior rectangle" );
+}
+
+void insert_extr_square_mode_cb(ModelSpace& sp, MenuObject& mo)
+{
+  sp.reset();
+  sp.state( UserState::InsertExtrSquare );
+  sp.last_action( "Insert exterior square" );
+}
+
 /***********************************************************
 * Callback function for moving nodes
 ***********************************************************/
@@ -687,4 +1517,101 @@ void clip_shape_cb(ModelSpace& sp, MenuObject& mo)
   sp.reset();
   sp.state( UserState::ClipShape );
   sp.last_action( "Clip shape" );
-}
\ No newline at end of file
+}
+
+/***********************************************************
+* Callback functions for offsetting shapes with the 
+* different joins
+***********************************************************/
+static void offset_mode(ModelSpace& sp, JoinType join)
+{
+  sp.reset();
+  sp.state( UserState::OffsetShape );
+  sp.offset_join( join );
+  sp.last_action( "Offset shape" );
+}
+
+void offset_miter_cb(ModelSpace& sp, MenuObject& mo)
+{
+  offset_mode(sp, JoinType::Miter);
+}
+
+void offset_round_cb(ModelSpace& sp, MenuObject& mo)
+{
+  offset_mode(sp, JoinType::Round);
+}
+
+void offset_square_cb(ModelSpace& sp, MenuObject& mo)
+{
+  offset_mode(sp, JoinType::Square);
+}
+
+/***********************************************************
+* Callback function for the multi-selection
+***********************************************************/
+void select_cb(ModelSpace& sp, MenuObject& mo)
+{
+  sp.reset();
+  sp.state( UserState::Select );
+  sp.last_action( "Select" );
+}
+
+/***********************************************************
+* Callback function for validating all shapes 
+***********************************************************/
+void validate_cb(ModelSpace& sp, MenuObject& mo)
+{
+  sp.reset();
+  sp.state( UserState::View );
+  sp.validate();
+}
+
+/***********************************************************
+* Callback function for showing the mesh 
+***********************************************************/
+void mesh_cb(ModelSpace& sp, MenuObject& mo)
+{
+  sp.reset();
+  sp.state( UserState::View );
+  sp.toggle_mesh();
+}
+
+/***********************************************************
+* Callback function for showing the filled domain
+***********************************************************/
+void fill_cb(ModelSpace& sp, MenuObject& mo)
+{
+  sp.reset();
+  sp.state( UserState::View );
+  sp.toggle_fill();
+}
+
+/***********************************************************
+* Callback function to toggle the object snapping
+***********************************************************/
+void snap_cb(ModelSpace& sp, MenuObject& mo)
+{
+  sp.reset();
+  sp.state( UserState::View );
+  sp.toggle_snap();
+}
+
+/***********************************************************
+* Callback function for the simplification of a shape
+***********************************************************/
+void simplify_shape_cb(ModelSpace& sp, MenuObject& mo)
+{
+  sp.reset();
+  sp.state( UserState::SimplifyShape );
+  sp.last_action( "Simplify shape" );
+}
+
+/***********************************************************
+* Callback function for the simplification of all shapes
+***********************************************************/
+void simplify_all_cb(ModelSpace& sp, MenuObject& mo)
+{
+  sp.reset();
+  sp.state( UserState::View );
+  sp.simplify_all();
+}
@@ -8,6 +8,18 @@
 
 #include "Menu.h"
 #include "Shape.h"
+#include "Profiler.h"
+#include "Job.h"
+#include "Mesh.h"
+#include "SizeField.h"
+#include "Rasterizer.h"
+#include "TileRenderer.h"
+#include "Snap.h"
+#include "Selection.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
 
 /***********************************************************
 * Program state
@@ -15,13 +27,19 @@
 enum class UserState {
   View,
   InsertExtrPolygon,
+  InsertExtrCircle,
+  InsertExtrRectangle,
+  InsertExtrSquare,
   MoveNode,
   MoveShape,
   RemoveShape,
   RemoveNode,
   InsertNode,
   MergeShapes,
-  ClipShape
+  ClipShape,
+  Select,
+  SimplifyShape,
+  OffsetShape
 };
 
 /***********************************************************
@@ -47,14 +65,16 @@ public:
   }
 
   // coordinate transformations
-  void coord_to_screen(const Vec2f& v, int& sx, int& sy);
-  void screen_to_coord(int sx, int sy, Vec2f& v);
+  void coord_to_screen(const Vec2r& v, int& sx, int& sy);
+  void coord_to_screen(const Vec2r& v, Vec2f& s);
+  void screen_to_coord(int sx, int sy, Vec2r& v);
 
-  Vec2f& mouse_coords() { return mouse_coords_; }
-  Vec2f& offset() { return offset_; }
+  Vec2r& mouse_coords() { return mouse_coords_; }
+  Vec2r& offset() { return offset_; }
 
   Grid& grid() { return grid_; }
   Cursor& cursor() { return cursor_; }
+  TileRenderer& renderer() { return renderer_; }
 
   float scale() const { return scale_; }
   float min_scale() const { return min_scale_; }
@@ -72,12 +92,19 @@ public:
   UserState state() { return state_; }
   void state(UserState s) { state_ = s; }
 
+  void offset_join(JoinType j) { offset_join_ = j; }
+
   Shape* temp_shape() { return temp_shape_; }
   void temp_shape(Shape* shape) { temp_shape_ = shape; }
 
   Node* selected_node() { return selected_node_; }
   void selected_node(Node* node) { selected_node_ = node; }
 
+  Selection& selection() { return selection_; }
+
+  // True, if nodes of the shape are selected for editing
+  bool editing(const Shape* s);
+
   void last_action(std::string s) {last_action_ = s; }
   std::string& last_action() { return last_action_; }
 
@@ -86,10 +113,32 @@ public:
   int number_of_intr_shapes() const 
   { return intr_shapes_.size(); }
 
+  std::vector<Shape*>& extr_shapes() { return extr_shapes_; }
+  std::vector<Shape*>& intr_shapes() { return intr_shapes_; }
+
+  void add_shape(Shape* s);
   void reset();
 
+  // Snap target within a radius around p, while snapping
+  // is enabled
+  SnapTarget snap(const Vec2r& p, Real radius);
+
+  // Counts modifications of the shapes, for the update of 
+  // derived data like the mesh
+  unsigned modified() { return ++revision_; }
+  unsigned revision() const { return revision_; }
+
+  // Model file input / output
+  bool load(const std::string& file);
+  bool save(const std::string& file);
+
+  // Offscreen rendering, for use without a running engine
+  void render_offscreen(olc::Sprite* target);
+  bool render_to_png(const std::string& file, int width, int height);
+
   // Shape insertion functions
   void insert_extr_polygon(); 
+  void insert_extr_primitive();
 
   void move_node(); 
   void remove_node(); 
@@ -98,6 +147,14 @@ public:
   void insert_node();
   void merge_shapes();
   void clip_shape();
+  void offset_shape();
+  void select();
+  void simplify();
+  void simplify_all();
+  void validate();
+  void toggle_mesh();
+  void toggle_fill();
+  void toggle_snap();
 
 private:
   Grid        grid_;
@@ -107,13 +164,23 @@ private:
 
   std::string  last_action_ = "View";
 
-  Vec2f   offset_         = {0.0f, 0.0f};
-  Vec2f   start_pan_      = {0.0f, 0.0f};
-  Vec2f   mouse_coords_   = {0.0f, 0.0f};
+  Vec2r   offset_         = {0.0f, 0.0f};
+  Vec2r   start_pan_      = {0.0f, 0.0f};
+  Vec2r   mouse_coords_   = {0.0f, 0.0f};
 
   Node*   selected_node_  = nullptr;
   Shape*  temp_shape_     = nullptr;
 
+  // First point of a primitive, which is inserted
+  Vec2r   anchor_         = {0.0f, 0.0f};
+
+  // Multi-selection, which is dragged or spanned by a band
+  Selection selection_;
+  bool    banding_        = false;
+  bool    dragging_       = false;
+  Vec2r   band_start_     = {0.0f, 0.0f};
+  Vec2r   drag_from_      = {0.0f, 0.0f};
+
   std::vector<Shape*> extr_shapes_;
   std::vector<Shape*> intr_shapes_;
 
@@ -121,13 +188,56 @@ private:
   float   max_scale_      = 100.0f;
   float   min_scale_      = 5.0f;
 
+  // Maximum deviation of simplified shapes in pixels
+  float   simplify_error_ = 1.0f;
+
+  // Join of convex corners of offset shapes
+  JoinType offset_join_   = JoinType::Round;
+
   UserState state_   = UserState::View;
 
+  bool    offscreen_init_ = false;
+
+  // Mesh of the domain, regenerated after modifications
+  SizeField size_field_;
+  Mesh      mesh_;
+  bool      show_mesh_      = false;
+  unsigned  mesh_revision_  = 0;
+  float     mesh_size_      = 0.0f;
+
+  // Filled preview of the domain
+  Rasterizer  raster_;
+  bool        show_fill_    = false;
+
+  // Object snapping of the cursor
+  SnapIndex   snap_index_;
+  bool        snap_enabled_ = true;
+  unsigned    snap_revision_ = 0;
+  Shape*      snap_extra_    = nullptr;
+
+  // Parallel renderer for the grid and the shapes
+  TileRenderer  renderer_;
+
+  std::atomic<unsigned> revision_ { 1 };
+
+#ifdef PIXMODELER_PROFILE
+  Profiler profiler_;
+#endif
+
+  // Background geometry jobs, declared last to finish
+  // all workers before other members are destroyed
+  JobQueue  jobs_;
+
   void pan_and_zoom();
+  void update_jobs();
+  void update_mesh();
   void draw_background();
   void draw_shapes();
+  void fit_view(int width, int height);
   void set_selected_node();
-  Shape* pick_shape(const Vec2f& c, bool extr_shape);
+  void select_band(const Vec2r& a, const Vec2r& b, bool shapes);
+  void draw_selection();
+  Shape* pick_shape(const Vec2r& c, bool extr_shape);
 
 };
 
@@ -136,10 +246,23 @@ private:
 * Menu callback functions
 ***********************************************************/
 void insert_extr_polygon_mode_cb(ModelSpace& sp, MenuObject& mo);
+void insert_extr_circle_mode_cb(ModelSpace& sp, MenuObject& mo);
+void insert_extr_rectangle_mode_cb(ModelSpace& sp, MenuObject& mo);
+void insert_extr_square_mode_cb(ModelSpace& sp, MenuObject& mo);
 void move_node_cb(ModelSpace& sp, MenuObject& mo);
 void move_shape_cb(ModelSpace& sp, MenuObject& mo);
 void remove_shape_cb(ModelSpace& sp, MenuObject& mo);
 void remove_node_cb(ModelSpace& sp, MenuObject& mo);
 void insert_node_cb(ModelSpace& sp, MenuObject& mo);
 void merge_shapes_cb(ModelSpace& sp, MenuObject& mo);
-void clip_shape_cb(ModelSpace& sp, MenuObject& mo);
\ No newline at end of file
+void clip_shape_cb(ModelSpace& sp, MenuObject& mo);
+void offset_miter_cb(ModelSpace& sp, MenuObject& mo);
+void offset_round_cb(ModelSpace& sp, MenuObject& mo);
+void offset_square_cb(ModelSpace& sp, MenuObject& mo);
+void select_cb(ModelSpace& sp, MenuObject& mo);
+void validate_cb(ModelSpace& sp, MenuObject& mo);
+void mesh_cb(ModelSpace& sp, MenuObject& mo);
+void fill_cb(ModelSpace& sp, MenuObject& mo);
+void snap_cb(ModelSpace& sp, MenuObject& mo);
+void simplify_shape_cb(ModelSpace& sp, MenuObject& mo);
+void simplify_all_cb(ModelSpace& sp, MenuObject& mo);
\ No newline at end of file
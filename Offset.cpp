@@ -0,0 +1,745 @@
+#include "Offset.h"
+#include "Job.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+static constexpr double pi = 3.14159265358979;
+
+/***********************************************************
+* Function to create the raw offset curve of the polygon c,
+* which is oriented counter-clockwise in the mathematical
+* sense
+***********************************************************/
+static void raw_offset(const std::vector<Vec2d>& c, double d,
+                       JoinType join, double max_error,
+                       std::vector<Vec2d>& r)
+{
+  int N = c.size();
+  double ad = std::fabs(d);
+
+  // Angle of a chord, which deviates by max_error from an
+  // arc of radius |d|
+  double step = (ad > max_error)
+            ? 2.0 * std::acos(1.0 - max_error / ad)
+            : 0.5 * pi;
+
+  r.clear();
+  r.reserve(2 * N);
+
+  for (int i = 0; i < N; ++i)
+  {
+    const Vec2d& v = c[i];
+    Vec2d u0 = unit_vector(v - c[(i+N-1)%N]);
+    Vec2d u1 = unit_vector(c[(i+1)%N] - v);
+    Vec2d n0 = { u0[1], -u0[0] };
+    Vec2d n1 = { u1[1], -u1[0] };
+
+    Vec2d p0 = v + n0 * d;
+    Vec2d p1 = v + n1 * d;
+
+    double sn = cross(u0, u1);
+    double cs = dot(u0, u1);
+
+    // Straight continuation
+    if (std::fabs(sn) < 1.0e-6 && cs > 0.0)
+    {
+      r.push_back(p0);
+      continue;
+    }
+
+    // The offset edges overlap, their loop is removed
+    // afterwards
+    if (sn * d < 0.0)
+    {
+      r.push_back(p0);
+      r.push_back(v);
+      r.push_back(p1);
+      continue;
+    }
+
+    // Miter joins are squared beyond the limit, square
+    // joins equal miters up to right angles
+    bool miter = (join == JoinType::Miter &&
+                  1.0 + cs >= 2.0 / (miter_limit * miter_limit))
+              || (join == JoinType::Square && cs >= 0.0);
+
+    if (miter)
+      r.push_back( v + (n0 + n1) * (d / (1.0 + cs)) );
+    else if (join == JoinType::Round)
+    {
+      // Rotation from n0 to n1 around the corner, a full
+      // reversal is turned around the outer side
+      double phi = std::atan2(std::fabs(sn), cs) * (d < 0.0 ? -1.0 : 1.0);
+      int n = maximum(1, int(std::ceil(std::fabs(phi) / step)));
+
+      r.push_back(p0);
+      for (int k = 1; k < n; ++k)
+      {
+        double a = phi * k / n;
+        Vec2d m = { n0[0] * std::cos(a) - n0[1] * std::sin(a),
+                    n0[0] * std::sin(a) + n0[1] * std::cos(a) };
+        r.push_back( v + m * d );
+      }
+      r.push_back(p1);
+    }
+    else
+    {
+      r.push_back( p0 + u0 * ad );
+      r.push_back( p1 - u1 * ad );
+    }
+  }
+}
+
+/***********************************************************
+* Piece of the raw curve between two vertices. Coincident
+* pieces are combined, their multiplicity counts how often
+* the curve passes along the piece in its direction.
+***********************************************************/
+struct Piece
+{
+  int   from;
+  int   to;
+  int   multiplicity = 1;
+  bool  kept = false;
+  bool  used = false;
+};
+
+/***********************************************************
+* Function to find all points, where the segments of the 
+* closed curve r are split: crossings of two segments and
+* nodes on other segments, which include the ends of 
+* collinear overlaps. A node within the distance tol of a 
+* segment splits it at the node itself, instead of a new
+* vertex next to the node. The segments are sorted and 
+* swept along the x-axis. New vertices are appended to v,
+* which starts with r.
+***********************************************************/
+static void find_splits(const std::vector<Vec2d>& r, double tol,
+                        std::vector<Vec2d>& v,
+                        std::vector<std::vector<std::pair<double,int>>>& splits)
+{
+  int M = r.size();
+  v = r;
+  splits.assign(M, {});
+
+  std::vector<int> order(M);
+  for (int k = 0; k < M; ++k)
+    order[k] = k;
+
+  auto lo_x = [&](int k)
+  { return minimum(r[k][0], r[(k+1)%M][0]); };
+  auto hi_x = [&](int k)
+  { return maximum(r[k][0], r[(k+1)%M][0]); };
+
+  std::sort(order.begin(), order.end(), [&](int a, int b)
+  { return lo_x(a) < lo_x(b); });
+
+  // Returns true, if the node n lies within tol of the 
+  // segment k, which is split, if n is apart from its ends
+  auto touches = [&](int k, int n)
+  {
+    const Vec2d& a = r[k];
+    const Vec2d& b = r[(k+1)%M];
+    Vec2d ab = b - a;
+    double l2 = dot(ab, ab);
+    double t  = (l2 > 0.0) ? dot(r[n] - a, ab) / l2 : 0.0;
+    t = minimum(1.0, maximum(0.0, t));
+
+    if ((a + ab * t - r[n]).length_squared() > tol * tol)
+      return false;
+
+    if ( (r[n] - a).length_squared() > tol * tol &&
+         (r[n] - b).length_squared() > tol * tol )
+      splits[k].push_back( { t, n } );
+
+    return true;
+  };
+
+  std::vector<int> active;
+
+  for (int k : order)
+  {
+    const Vec2d& a = r[k];
+    const Vec2d& b = r[(k+1)%M];
+    Vec2d ab = b - a;
+    double k_lo_y = minimum(a[1], b[1]) - tol;
+    double k_hi_y = maximum(a[1], b[1]) + tol;
+
+    active.erase( std::remove_if(active.begin(), active.end(),
+                  [&](int j) { return hi_x(j) + tol < lo_x(k); }),
+                  active.end() );
+
+    for (int j : active)
+    {
+      const Vec2d& p = r[j];
+      const Vec2d& q = r[(j+1)%M];
+
+      if ( maximum(p[1], q[1]) < k_lo_y ||
+           minimum(p[1], q[1]) > k_hi_y )
+        continue;
+
+      // Nodes on the other segment, including the shared 
+      // node of adjacent segments and collinear overlaps
+      bool touch = touches(k, j);
+      touch = touches(k, (j+1)%M) || touch;
+      touch = touches(j, k)       || touch;
+      touch = touches(j, (k+1)%M) || touch;
+
+      // Two segments meet at most once, unless they overlap
+      if (touch)
+        continue;
+
+      Vec2d pq = q - p;
+      double s_p = cross(ab, p - a);
+      double s_q = cross(ab, q - a);
+      double s_a = cross(pq, a - p);
+      double s_b = cross(pq, b - p);
+
+      if ( !((s_p < 0.0 && s_q > 0.0) || (s_p > 0.0 && s_q < 0.0)) ||
+           !((s_a < 0.0 && s_b > 0.0) || (s_a > 0.0 && s_b < 0.0)) )
+        continue;
+
+      double t = s_a / (s_a - s_b);
+      double u = s_p / (s_p - s_q);
+
+      int id = v.size();
+      v.push_back( a + ab * t );
+      splits[k].push_back( { t, id } );
+      splits[j].push_back( { u, id } );
+    }
+
+    active.push_back(k);
+  }
+}
+
+/***********************************************************
+* Function to merge the vertices within the distance tol of
+* each other. Returns the index of the first vertex of its
+* group for every vertex.
+***********************************************************/
+static std::vector<int> merge_vertices(const std::vector<Vec2d>& v,
+                                       double tol)
+{
+  int V = v.size();
+  std::vector<int> id(V);
+  for (int i = 0; i < V; ++i)
+    id[i] = i;
+
+  auto find = [&](int i)
+  {
+    while (id[i] != i)
+      i = id[i] = id[id[i]];
+    return i;
+  };
+
+  std::vector<int> sorted(id);
+  std::sort(sorted.begin(), sorted.end(), [&](int a, int b)
+  { return v[a][0] < v[b][0]; });
+
+  for (int i = 0; i < V; ++i)
+    for (int j = i+1; j < V; ++j)
+    {
+      int a = sorted[i];
+      int b = sorted[j];
+
+      if (v[b][0] - v[a][0] > tol)
+        break;
+
+      if ((v[b] - v[a]).length_squared() > tol * tol)
+        continue;
+
+      int ra = find(a);
+      int rb = find(b);
+      id[maximum(ra, rb)] = minimum(ra, rb);
+    }
+
+  for (int i = 0; i < V; ++i)
+    id[i] = find(i);
+
+  return id;
+}
+
+/***********************************************************
+* Function to split the closed curve r into pieces between
+* its self-intersections. Vertices within the distance tol
+* are merged, coincident pieces are combined.
+***********************************************************/
+static void split_curve(const std::vector<Vec2d>& r, double tol,
+                        std::vector<Vec2d>& v,
+                        std::vector<Piece>& pieces)
+{
+  TRACE_ZONE("split_curve");
+
+  int M = r.size();
+  std::vector<std::vector<std::pair<double,int>>> splits;
+  find_splits(r, tol, v, splits);
+
+  std::vector<int> id = merge_vertices(v, tol);
+
+  // Combine coincident pieces
+  std::unordered_map<uint64_t, int> index;
+  index.reserve(2 * v.size());
+  pieces.clear();
+
+  auto add = [&](int from, int to)
+  {
+    from = id[from];
+    to   = id[to];
+    if (from == to)
+      return;
+
+    uint64_t key = (uint64_t(minimum(from, to)) << 32) 
+                 | uint64_t(maximum(from, to));
+
+    auto it = index.find(key);
+    if (it == index.end())
+    {
+      index.emplace(key, pieces.size());
+      pieces.push_back( Piece { from, to } );
+    }
+    else
+    {
+      Piece& p = pieces[it->second];
+      p.multiplicity += (p.from == from) ? 1 : -1;
+    }
+  };
+
+  for (int k = 0; k < M; ++k)
+  {
+    std::sort(splits[k].begin(), splits[k].end());
+
+    int from = k;
+    for (const auto& s : splits[k])
+    {
+      add(from, s.second);
+      from = s.second;
+    }
+    add(from, (k+1)%M);
+  }
+
+  // Orient the pieces along their multiplicity
+  pieces.erase( std::remove_if(pieces.begin(), pieces.end(),
+                [](const Piece& p) { return p.multiplicity == 0; }),
+                pieces.end() );
+
+  for (auto& p : pieces)
+    if (p.multiplicity < 0)
+    {
+      std::swap(p.from, p.to);
+      p.multiplicity = -p.multiplicity;
+    }
+}
+
+/***********************************************************
+* Function returns the winding number of the pieces, which
+* do not belong to the connected part c, at the point x.
+***********************************************************/
+static int winding(const std::vector<Vec2d>& v,
+                   const std::vector<Piece>& pieces,
+                   const std::vector<int>& part, int c, const Vec2d& x)
+{
+  int w = 0;
+
+  for (const auto& f : pieces)
+  {
+    if (part[f.from] == c)
+      continue;
+
+    const Vec2d& p = v[f.from];
+    const Vec2d& q = v[f.to];
+
+    if (p[1] <= x[1] && q[1] > x[1] && cross(q - p, x - p) > 0.0)
+      w += f.multiplicity;
+    else if (q[1] <= x[1] && p[1] > x[1] && cross(q - p, x - p) < 0.0)
+      w -= f.multiplicity;
+  }
+
+  return w;
+}
+
+/***********************************************************
+* Function to mark the pieces, which bound the region of 
+* positive winding number on their left side.
+*
+* Every connected part of the curve is seeded at its
+* leftmost vertex, where the sector facing left lies 
+* outside of the part. Its winding number is evaluated with
+* a ray, which only counts the other parts. The pieces around every vertex are sorted by their angle,
+* the winding numbers of the sectors between them differ 
+* by the multiplicities of the pieces. Thus, the numbers
+* are passed on from piece to piece in O(n log n) in total
+* and are consistent at every vertex.
+***********************************************************/
+static void mark_boundary(const std::vector<Vec2d>& v,
+                          std::vector<Piece>& pieces)
+{
+  TRACE_ZONE("mark_boundary");
+
+  int P = pieces.size();
+
+  // Pieces around every vertex in counter-clockwise order, 
+  // stored as 2 e for outgoing and 2 e + 1 for incoming
+  std::vector<std::vector<int>> around(v.size());
+  for (int e = 0; e < P; ++e)
+  {
+    around[pieces[e].from].push_back(2*e);
+    around[pieces[e].to].push_back(2*e+1);
+  }
+
+  for (int i = 0; i < v.size(); ++i)
+  {
+    std::vector<int>& h = around[i];
+    if (h.size() < 3)
+      continue;
+
+    std::vector<std::pair<double,int>> angles(h.size());
+    for (int j = 0; j < h.size(); ++j)
+    {
+      const Piece& e = pieces[h[j] / 2];
+      Vec2d d = v[(h[j] & 1) ? e.from : e.to] - v[i];
+      angles[j] = { std::atan2(d[1], d[0]), h[j] };
+    }
+    std::sort(angles.begin(), angles.end());
+
+    for (int j = 0; j < h.size(); ++j)
+      h[j] = angles[j].second;
+  }
+
+  // Connected parts of the curve and their leftmost vertices
+  std::vector<int> part(v.size(), -1);
+  std::vector<int> leftmost;
+  std::vector<int> stack;
+
+  for (int i = 0; i < v.size(); ++i)
+  {
+    if (around[i].empty() || part[i] >= 0)
+      continue;
+
+    int c = leftmost.size();
+    leftmost.push_back(i);
+    part[i] = c;
+    stack.push_back(i);
+
+    while (!stack.empty())
+    {
+      int at = stack.back();
+      stack.pop_back();
+
+      const Vec2d& l = v[leftmost[c]];
+      if (v[at][0] < l[0] || (v[at][0] == l[0] && v[at][1] < l[1]))
+        leftmost[c] = at;
+
+      for (int h : around[at])
+      {
+        const Piece& e = pieces[h / 2];
+        int other = (h & 1) ? e.from : e.to;
+        if (part[other] < 0)
+        {
+          part[other] = c;
+          stack.push_back(other);
+        }
+      }
+    }
+  }
+
+  // Winding numbers on the right side of the pieces
+  std::vector<int>  w(P, 0);
+  std::vector<bool> known(P, false);
+  std::vector<bool> visited(v.size(), false);
+  std::vector<int>  queue;
+
+  for (int c = 0; c < leftmost.size(); ++c)
+  {
+    // No piece points to the left of the leftmost vertex, thus
+    // the sector after the piece with the largest angle faces
+    // left. Ties are broken as in the sorted order above.
+    int l = leftmost[c];
+    std::pair<double,int> last { 0.0, -1 };
+    for (int h : around[l])
+    {
+      const Piece& e = pieces[h / 2];
+      Vec2d d = v[(h & 1) ? e.from : e.to] - v[l];
+      std::pair<double,int> angle { std::atan2(d[1], d[0]), h };
+      if (last.second < 0 || last < angle)
+        last = angle;
+    }
+
+    int h_p  = last.second;
+    int seed = h_p / 2;
+    w[seed] = winding(v, pieces, part, c, v[l])
+            - ((h_p & 1) ? 0 : pieces[seed].multiplicity);
+    known[seed] = true;
+    queue.push_back(seed);
+
+    while (!queue.empty())
+    {
+      int e = queue.back();
+      queue.pop_back();
+
+      for (int at : {pieces[e].from, pieces[e].to})
+      {
+        if (visited[at])
+          continue;
+        visited[at] = true;
+
+        const std::vector<int>& h = around[at];
+        int n = h.size();
+        int i = 0;
+        while (h[i] / 2 != e)
+          ++i;
+
+        // The sector after an outgoing piece is on its left,
+        // the sector before an incoming piece as well
+        for (int step = 1; step < n; ++step)
+        {
+          int h_p = h[(i+step-1) % n];
+          int h_c = h[(i+step) % n];
+          const Piece& p = pieces[h_p / 2];
+          const Piece& c = pieces[h_c / 2];
+
+          int w_sector = w[h_p / 2] + ((h_p & 1) ? 0 : p.multiplicity);
+
+          if (!known[h_c / 2])
+          {
+            w[h_c / 2] = w_sector - ((h_c & 1) ? c.multiplicity : 0);
+            known[h_c / 2] = true;
+            queue.push_back(h_c / 2);
+          }
+        }
+      }
+    }
+  }
+
+  // Winding numbers w on the right, w + k on the left
+  for (int e = 0; e < P; ++e)
+    pieces[e].kept = (w[e] <= 0 && w[e] + pieces[e].multiplicity > 0);
+}
+
+/***********************************************************
+* Clockwise angle from u to w in [0, 2 pi)
+***********************************************************/
+static double clockwise_angle(const Vec2d& u, const Vec2d& w)
+{
+  double a = -std::atan2(cross(u, w), dot(u, w));
+  return (a < 0.0) ? a + 2.0 * pi : a;
+}
+
+/***********************************************************
+* Function to link the kept pieces to closed loops. Returns
+* false, if a loop does not close, which happens only if
+* the winding numbers of the pieces are inconsistent.
+***********************************************************/
+static bool link_loops(const std::vector<Vec2d>& v,
+                       std::vector<Piece>& pieces,
+                       std::vector<std::vector<Vec2d>>& loops)
+{
+  TRACE_ZONE("link_loops");
+
+  std::vector<std::vector<int>> outgoing(v.size());
+  for (int e = 0; e < pieces.size(); ++e)
+    if (pieces[e].kept)
+      outgoing[pieces[e].from].push_back(e);
+
+  for (int start = 0; start < pieces.size(); ++start)
+  {
+    if (!pieces[start].kept || pieces[start].used)
+      continue;
+
+    std::vector<Vec2d> loop;
+    int e = start;
+    bool closed = false;
+
+    while (true)
+    {
+      pieces[e].used = true;
+      loop.push_back( v[pieces[e].from] );
+
+      int at = pieces[e].to;
+      Vec2d back = v[pieces[e].from] - v[at];
+
+      // The region lies on the left, so the first piece
+      // clockwise from the way back bounds it
+      int  next = -1;
+      double best = 0.0;
+
+      for (int f : outgoing[at])
+      {
+        if (pieces[f].used && f != start)
+          continue;
+
+        double a = clockwise_angle(back, v[pieces[f].to] - v[at]);
+        if (a == 0.0)
+          a = 2.0 * pi;
+
+        if (next < 0 || a < best)
+        {
+          next = f;
+          best = a;
+        }
+      }
+
+      if (next < 0)
+        break;
+
+      if (next == start)
+      {
+        closed = true;
+        break;
+      }
+
+      e = next;
+    }
+
+    if (!closed)
+      return false;
+
+    if (loop.size() >= 3)
+      loops.push_back( std::move(loop) );
+  }
+
+  return true;
+}
+
+/***********************************************************
+* Twice the signed area of the polygon c
+***********************************************************/
+static double area2(const std::vector<Vec2d>& c)
+{
+  double a = 0.0;
+  for (int i = 0, j = c.size()-1; i < c.size(); j = i++)
+    a += cross(c[j], c[i]);
+  return a;
+}
+
+/***********************************************************
+* Function to offset a polygon
+***********************************************************/
+bool offset_polygon(const std::vector<Vec2r>& c, Real d,
+                    JoinType join, Real max_error,
+                    std::vector<std::vector<Vec2r>>& outer,
+                    std::vector<std::vector<Vec2r>>& holes,
+                    JobControl* ctl)
+{
+  TRACE_ZONE("offset_polygon");
+
+  // Drop repeated nodes, the offset needs the directions
+  // of all edges. The curve is processed in double 
+  // precision, whose rounding errors can not change the
+  // topology of the pieces for model coordinates.
+  std::vector<Vec2d> p;
+  p.reserve(c.size());
+  for (const auto& n : c)
+  {
+    Vec2d q { double(n[0]), double(n[1]) };
+    if (p.empty() || !(q == p.back()))
+      p.push_back(q);
+  }
+  while (p.size() > 1 && p.back() == p.front())
+    p.pop_back();
+
+  if (p.size() < 3)
+    return true;
+
+  // Offset the counter-clockwise orientation
+  bool reversed = area2(p) < 0.0;
+  if (reversed)
+    std::reverse(p.begin(), p.end());
+
+  std::vector<Vec2d> r;
+  raw_offset(p, d, join, max_error, r);
+
+  if (ctl && ctl->cancelled())
+    return false;
+
+  // Rounding errors of the raw curve stay far below this
+  // tolerance, which is far below the resolution of Real
+  double magnitude = 0.0;
+  for (const auto& q : r)
+    magnitude = maximum(magnitude, maximum(std::fabs(q[0]), 
+                                           std::fabs(q[1])));
+  double tol = 1.0e-12 * magnitude;
+
+  std::vector<Vec2d> v;
+  std::vector<Piece> pieces;
+  split_curve(r, tol, v, pieces);
+
+  if (ctl)
+  {
+    if (ctl->cancelled())
+      return false;
+    ctl->progress(0.5f);
+  }
+
+  mark_boundary(v, pieces);
+
+  if (ctl)
+  {
+    if (ctl->cancelled())
+      return false;
+    ctl->progress(0.9f);
+  }
+
+  std::vector<std::vector<Vec2d>> loops;
+  if (!link_loops(v, pieces, loops))
+    return false;
+
+  for (auto& loop : loops)
+  {
+    double a = area2(loop);
+
+    if (a == 0.0)
+      continue;
+
+    if ((a < 0.0) != reversed)
+      std::reverse(loop.begin(), loop.end());
+
+    std::vector<Vec2r> l(loop.size());
+    for (int i = 0; i < loop.size(); ++i)
+      l[i] = Vec2r { Real(loop[i][0]), Real(loop[i][1]) };
+
+    if (a > 0.0)
+      outer.push_back( std::move(l) );
+    else
+      holes.push_back( std::move(l) );
+  }
+
+  return true;
+}
+
+/***********************************************************
+* Function returns the signed distance of p to the boundary
+* of the polygon c, using the crossing number test for its
+* sign
+***********************************************************/
+Real signed_distance(const std::vector<Vec2r>& c, const Vec2r& p)
+{
+  int N = c.size();
+  if (N == 0)
+    return 0.0f;
+
+  Real d2 = (p - c[0]).length_squared();
+  bool in = false;
+
+  for (int i = 0, j = N-1; i < N; j = i++)
+  {
+    const Vec2r& a = c[j];
+    const Vec2r& b = c[i];
+    Vec2r ab = b - a;
+
+    Real l2 = dot(ab, ab);
+    Real t  = (l2 > 0.0f) ? dot(p - a, ab) / l2 : 0.0f;
+    t = minimum(Real(1), maximum(Real(0), t));
+
+    d2 = minimum(d2, Real((p - (a + ab * t)).length_squared()));
+
+    if ( (b[1] > p[1]) != (a[1] > p[1]) &&
+         p[0] < (a[0]-b[0]) * (p[1]-b[1]) / (a[1]-b[1]) + b[0] )
+      in = !in;
+  }
+
+  Real dist = std::sqrt(d2);
+  return in ? -dist : dist;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+
+#include "Vec2.h"
+
+class JobControl;
+
+/***********************************************************
+* Joins of the offset edges at convex corners
+***********************************************************/
+enum class JoinType {
+  Miter,    // Sharp corners, squared beyond the miter limit
+  Round,    // Circular arcs around the corners
+  Square    // Corners cut at the offset distance
+};
+
+// Maximum distance of a miter tip from its corner, relative
+// to the offset distance
+static constexpr float miter_limit = 2.0f;
+
+/***********************************************************
+* Polygon offsetting.
+*
+* Every edge of the polygon c is shifted by the distance d
+* along its outer normal, positive distances inflate and
+* negative ones deflate the polygon. Convex corners are
+* closed with the given join. Round joins deviate less than
+* max_error from the exact arcs. Concave corners are
+* connected through the original node, as well as convex
+* corners of deflated polygons.
+*
+* The resulting raw offset curve overlaps itself near
+* concave corners and narrow parts. Its self-intersections
+* are found by sorting and sweeping the bounding boxes of
+* its segments, which are then split into pieces at the
+* intersections. Nodes on other segments split them at the
+* node itself and vertices closer than the rounding errors
+* of the curve are merged, such that touching parts of the
+* curve share their vertices. Coincident pieces are merged
+* and counted with their multiplicity. A piece is kept, if the winding
+* number of the curve is zero on its outer side, such that
+* the kept pieces bound the region of positive winding.
+* The winding number is evaluated with a ray for a single
+* piece of every connected part of the curve and carried
+* over to the other pieces around their common nodes.
+* All of this is done in double precision.
+*
+* The kept pieces are linked to loops, which turn as far
+* as possible towards the region at nodes, where several
+* loops touch. Loops with the orientation of c are outer
+* boundaries, the others are holes.
+*
+* The polygon c may have either orientation, all loops are
+* returned in the orientation of c. Returns false, if the
+* operation has been cancelled, or if the kept pieces do 
+* not close to loops.
+***********************************************************/
+bool offset_polygon(const std::vector<Vec2r>& c, Real d,
+                    JoinType join, Real max_error,
+                    std::vector<std::vector<Vec2r>>& outer,
+                    std::vector<std::vector<Vec2r>>& holes,
+                    JobControl* ctl = nullptr);
+
+// Signed distance of p to the boundary of the closed
+// polygon c, negative inside
+Real signed_distance(const std::vector<Vec2r>& c, const Vec2r& p);
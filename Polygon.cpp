@@ -0,0 +1,258 @@
+#include "Polygon.h"
+#include "ModelSpace.h"
+
+#include <cmath>
+
+static constexpr Real pi = Real(3.14159265358979);
+
+/***********************************************************
+* Polygon
+***********************************************************/
+Polygon::Polygon(ModelSpace& space, int index, bool extr,
+                 const std::vector<Vec2r>& c)
+: Shape(space, index, extr)
+{
+  for (int i = 0; i < c.size(); ++i)
+    nodes_.push_back( new Node {*this, i, c[i]} );
+
+  complete_ = true;
+  invalidate();
+}
+
+/***********************************************************
+* Function to draw the outline of the shape, which is 
+* tessellated for the current scale
+***********************************************************/
+void Parametric::draw()
+{
+  const std::vector<Vec2r>* c = drawn_outline();
+
+  if (!c)
+  {
+    Shape::draw();
+    return;
+  }
+
+  Vec2f s, e;
+  space_.coord_to_screen(c->back(), s);
+
+  for (const Vec2r& p : *c)
+  {
+    space_.coord_to_screen(p, e);
+    space_.renderer().draw_line_aa(s, e, color_);
+    s = e;
+  }
+}
+
+/***********************************************************
+* Shapes with selected nodes are drawn along their nodes,
+* since they are currently edited
+***********************************************************/
+const std::vector<Vec2r>* Parametric::drawn_outline()
+{
+  if (space_.editing(this))
+    return nullptr;
+
+  return tessellation();
+}
+
+/***********************************************************
+* Function to move the entire shape
+***********************************************************/
+void Parametric::move(const Vec2r& d)
+{
+  Shape::move(d);
+  moved(d);
+}
+
+/***********************************************************
+* Function to move the parameters and the cached 
+* tessellations along with the nodes
+***********************************************************/
+void Parametric::moved(const Vec2r& d)
+{
+  for (auto& o : outlines_)
+    for (auto& c : o.second)
+      c += d;
+
+  if (parametric_)
+    tessellated_revision_ = revision_;
+}
+
+/***********************************************************
+* Function to return the outline for the current scale of
+* the model space. The segment count of a zoom bucket is
+* chosen at its largest scale, such that the error bound
+* holds within the entire bucket. At the largest scale of
+* the model space, the outline matches the nodes.
+***********************************************************/
+const std::vector<Vec2r>* Parametric::tessellation()
+{
+  if (!parametric_)
+    return nullptr;
+
+  // Nodes have been edited since the last tessellation
+  if (revision_ != tessellated_revision_)
+  {
+    parametric_ = false;
+    outlines_.clear();
+    return nullptr;
+  }
+
+  int bucket = int(std::floor(4.0f * std::log2(space_.scale())));
+
+  auto it = outlines_.find(bucket);
+  if (it == outlines_.end())
+  {
+    std::vector<Vec2r> c;
+    float scale = minimum(std::exp2((bucket + 1) / 4.0f),
+                          space_.max_scale());
+    outline(segments(scale), c);
+    it = outlines_.emplace(bucket, std::move(c)).first;
+  }
+
+  return &it->second;
+}
+
+/***********************************************************
+* Function to discard the cached tessellations and to
+* tessellate the nodes with the new parameters at the
+* largest scale
+***********************************************************/
+void Parametric::reshape()
+{
+  outlines_.clear();
+  parametric_ = true;
+
+  std::vector<Vec2r> c;
+  outline(segments(space_.max_scale()), c);
+  set_nodes(c);
+}
+
+/***********************************************************
+* Function to replace the nodes of the shape
+***********************************************************/
+void Parametric::set_nodes(const std::vector<Vec2r>& c)
+{
+  for (auto n : nodes_)
+    delete n;
+  nodes_.clear();
+
+  for (int i = 0; i < c.size(); ++i)
+    nodes_.push_back( new Node {*this, i, c[i]} );
+
+  complete_ = true;
+  invalidate();
+  tessellated_revision_ = revision_;
+}
+
+/***********************************************************
+* Circle
+***********************************************************/
+Circle::Circle(ModelSpace& space, int index, bool extr,
+               const Vec2r& center, Real radius)
+: Parametric(space, index, extr), center_{center}, radius_{radius}
+{
+  reshape();
+}
+
+void Circle::set(const Vec2r& center, Real radius)
+{
+  if (center == center_ && radius == radius_ && parametric())
+    return;
+
+  center_ = center;
+  radius_ = radius;
+  reshape();
+}
+
+void Circle::moved(const Vec2r& d)
+{
+  Parametric::moved(d);
+  center_ += d;
+}
+
+/***********************************************************
+* A chord of the angle 2 pi / n deviates by the sagitta
+*   r (1 - cos(pi / n))
+* from the circle, which is solved for n
+***********************************************************/
+int Circle::segments(float scale) const
+{
+  Real r = radius_ * scale;
+
+  if (r <= max_error)
+    return 8;
+
+  Real n = pi / std::acos(1.0f - max_error / r);
+
+  return maximum(8, minimum(max_segments, int(std::ceil(n))));
+}
+
+void Circle::outline(int n, std::vector<Vec2r>& c) const
+{
+  c.resize(n);
+  for (int i = 0; i < n; ++i)
+  {
+    Real phi = -2 * pi * i / n;
+    c[i] = center_ + Vec2r { std::cos(phi), std::sin(phi) } * radius_;
+  }
+}
+
+/***********************************************************
+* Rectangle
+***********************************************************/
+Rectangle::Rectangle(ModelSpace& space, int index, bool extr,
+                     const Vec2r& a, const Vec2r& b)
+: Parametric(space, index, extr), lo_{bbox_min(a, b)}, hi_{bbox_max(a, b)}
+{
+  reshape();
+}
+
+void Rectangle::set(const Vec2r& a, const Vec2r& b)
+{
+  if (bbox_min(a, b) == lo_ && bbox_max(a, b) == hi_ && parametric())
+    return;
+
+  lo_ = bbox_min(a, b);
+  hi_ = bbox_max(a, b);
+  reshape();
+}
+
+void Rectangle::moved(const Vec2r& d)
+{
+  Parametric::moved(d);
+  lo_ += d;
+  hi_ += d;
+}
+
+void Rectangle::outline(int n, std::vector<Vec2r>& c) const
+{
+  c = { lo_, {lo_[0], hi_[1]}, hi_, {hi_[0], lo_[1]} };
+}
+
+/***********************************************************
+* Square
+***********************************************************/
+Square::Square(ModelSpace& space, int index, bool extr,
+               const Vec2r& corner, const Vec2r& towards)
+: Rectangle(space, index, extr, corner, opposite(corner, towards))
+{}
+
+void Square::set(const Vec2r& corner, const Vec2r& towards)
+{
+  Rectangle::set(corner, opposite(corner, towards));
+}
+
+/***********************************************************
+* The side length is the larger extent towards the given
+* point
+***********************************************************/
+Vec2r Square::opposite(const Vec2r& corner, const Vec2r& towards)
+{
+  Vec2r d = towards - corner;
+  Real a = maximum(std::fabs(d[0]), std::fabs(d[1]));
+
+  return corner + Vec2r { std::copysign(a, d[0]),
+                          std::copysign(a, d[1]) };
+}
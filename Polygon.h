@@ -1,16 +1,157 @@
 #pragma once
 
+#include <map>
+#include <vector>
+
 #include "Shape.h"
 #include "Vec2.h"
 
 /***********************************************************
-* This class defines a polygonal element 
-* A polygon actually offers the same properties as a 
+* This class defines a polygonal element
+* A polygon actually offers the same properties as a
 * general shape but is defined for consistency.
 ***********************************************************/
 class Polygon : public Shape
 {
 public:
-  Polygon(ModelSpace& space, int index, bool extr) 
+  Polygon(ModelSpace& space, int index, bool extr)
   : Shape(space, index, extr) {}
-};
\ No newline at end of file
+
+  // Complete polygon with the given nodes, which must be
+  // ordered counter-clockwise
+  Polygon(ModelSpace& space, int index, bool extr,
+          const std::vector<Vec2r>& c);
+};
+
+/***********************************************************
+* This class defines a shape, which is given by a few
+* parameters instead of its nodes.
+*
+* The nodes are a tessellation of the outline, which 
+* deviates less than max_error pixels from the exact shape
+* at the largest scale of the model space. Thus the model
+* is faithful at every zoom. The nodes only change along 
+* with the parameters.
+*
+* Zoomed out, the shape is drawn and filled with fewer
+* segments, which keep the same error at the current 
+* scale. These tessellations are cached per zoom bucket of
+* a quarter octave, such that zooming back and forth does
+* not recompute them.
+*
+* Once its nodes are edited directly, the shape keeps them
+* and behaves like a polygon.
+***********************************************************/
+class Parametric : public Polygon
+{
+public:
+  static constexpr float max_error    = 0.25f;
+  static constexpr int   max_segments = 4096;
+
+  Parametric(ModelSpace& space, int index, bool extr)
+  : Polygon(space, index, extr) {}
+
+  void draw() override;
+  void move(const Vec2r& d) override;
+
+  // Notifies the shape, that all of its nodes have been
+  // moved by d, such that it keeps its parameters
+  virtual void moved(const Vec2r& d);
+
+  // False, once the nodes have been edited directly
+  bool parametric() const
+  { return parametric_ && revision_ == tessellated_revision_; }
+
+  // Outline, which is drawn at the current scale, or 
+  // nullptr if the shape is drawn along its nodes
+  const std::vector<Vec2r>* drawn_outline();
+
+protected:
+  // Number of segments for the given scale in pixels per
+  // unit length
+  virtual int segments(float scale) const = 0;
+
+  // Outline with n segments in counter-clockwise order
+  virtual void outline(int n, std::vector<Vec2r>& c) const = 0;
+
+  // Discards the cached tessellations after a change of
+  // the parameters and tessellates the nodes
+  void reshape();
+
+private:
+  std::map<int, std::vector<Vec2r>> outlines_;
+  unsigned  tessellated_revision_ = 0;
+  bool      parametric_ = true;
+
+  void set_nodes(const std::vector<Vec2r>& c);
+
+  // Cached outline for the current scale, or nullptr once
+  // the nodes have been edited
+  const std::vector<Vec2r>* tessellation();
+};
+
+/***********************************************************
+* Circle given by its center and radius
+***********************************************************/
+class Circle : public Parametric
+{
+public:
+  Circle(ModelSpace& space, int index, bool extr,
+         const Vec2r& center, Real radius);
+
+  void set(const Vec2r& center, Real radius);
+
+  Vec2r center() const { return center_; }
+  Real  radius() const { return radius_; }
+
+  void moved(const Vec2r& d) override;
+
+protected:
+  int  segments(float scale) const override;
+  void outline(int n, std::vector<Vec2r>& c) const override;
+
+private:
+  Vec2r center_;
+  Real  radius_;
+};
+
+/***********************************************************
+* Axis-aligned rectangle given by two opposite corners
+***********************************************************/
+class Rectangle : public Parametric
+{
+public:
+  Rectangle(ModelSpace& space, int index, bool extr,
+            const Vec2r& a, const Vec2r& b);
+
+  void set(const Vec2r& a, const Vec2r& b);
+
+  Vec2r corner_min() const { return lo_; }
+  Vec2r corner_max() const { return hi_; }
+
+  void moved(const Vec2r& d) override;
+
+protected:
+  int  segments(float scale) const override { return 4; }
+  void outline(int n, std::vector<Vec2r>& c) const override;
+
+private:
+  Vec2r lo_;
+  Vec2r hi_;
+};
+
+/***********************************************************
+* Axis-aligned square given by a corner and the side
+* length, which extends towards the given direction
+***********************************************************/
+class Square : public Rectangle
+{
+public:
+  Square(ModelSpace& space, int index, bool extr,
+         const Vec2r& corner, const Vec2r& towards);
+
+  void set(const Vec2r& corner, const Vec2r& towards);
+
+private:
+  static Vec2r opposite(const Vec2r& corner, const Vec2r& towards);
+};
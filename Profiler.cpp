@@ -0,0 +1,150 @@
+#ifdef PIXMODELER_PROFILE
+
+#include "Profiler.h"
+#include "ModelSpace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+/***********************************************************
+* Global allocation counter
+***********************************************************/
+static std::atomic<std::size_t> allocation_count { 0 };
+
+void* operator new(std::size_t n)
+{
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+std::size_t Profiler::allocations()
+{
+  return allocation_count.load(std::memory_order_relaxed);
+}
+
+/***********************************************************
+* Names of the frame phases
+***********************************************************/
+static const char* phase_names[Profiler::n_phases] = {
+  "Input",
+  "Grid",
+  "Cursor",
+  "Menu",
+  "State",
+  "DrawGrid",
+  "DrawShapes",
+  "Render",
+  "DrawMenu"
+};
+
+/***********************************************************
+* Function to start the timing of a new frame
+***********************************************************/
+void Profiler::begin_frame()
+{
+  for (auto& p : phase_times_)
+    p[frame_] = 0.0f;
+
+  frame_start_ = Clock::now();
+  alloc_start_ = allocations();
+}
+
+/***********************************************************
+* Function to finish the timing of the current frame
+***********************************************************/
+void Profiler::end_frame()
+{
+  std::chrono::duration<float, std::micro> dt
+    = Clock::now() - frame_start_;
+
+  frame_times_[frame_]  = dt.count();
+  frame_allocs_[frame_] = float(allocations() - alloc_start_);
+
+  frame_    = (frame_ + 1) % history;
+  n_frames_ = std::min(n_frames_ + 1, history);
+}
+
+/***********************************************************
+* Function to compute the q-th percentile of the samples
+* of the last frames
+***********************************************************/
+float Profiler::percentile(const Samples& s, float q) const
+{
+  if (n_frames_ == 0)
+    return 0.0f;
+
+  Samples tmp = s;
+  int k = int(q * (n_frames_ - 1));
+  std::nth_element(tmp.begin(), tmp.begin() + k,
+                   tmp.begin() + n_frames_);
+  return tmp[k];
+}
+
+/***********************************************************
+* Function to draw the profiler overlay
+* Timings are given in microseconds
+***********************************************************/
+void Profiler::draw(ModelSpace& space)
+{
+  if (!visible_)
+    return;
+
+  const int width  = history + 24;
+  const int graph  = 30;
+  const int x      = space.ScreenWidth() - width - 4;
+  int       y      = 4;
+
+  space.FillRect(x-2, y-2, width+4, 8*(n_phases+3)+graph+6,
+                 olc::BLACK);
+
+  char line[32];
+  space.DrawString(x, y, "Phase       p50  p99", olc::YELLOW);
+  y += 8;
+
+  for (int i = 0; i < n_phases; ++i)
+  {
+    snprintf(line, sizeof(line), "%-10s%5.0f%5.0f", phase_names[i],
+             percentile(phase_times_[i], 0.5f),
+             percentile(phase_times_[i], 0.99f));
+    space.DrawString(x, y, line, olc::WHITE);
+    y += 8;
+  }
+
+  snprintf(line, sizeof(line), "%-10s%5.0f%5.0f", "Frame",
+           percentile(frame_times_, 0.5f),
+           percentile(frame_times_, 0.99f));
+  space.DrawString(x, y, line, olc::YELLOW);
+  y += 8;
+
+  snprintf(line, sizeof(line), "%-10s%5.0f%5.0f", "Allocs",
+           percentile(frame_allocs_, 0.5f),
+           percentile(frame_allocs_, 0.99f));
+  space.DrawString(x, y, line, olc::WHITE);
+  y += 8 + graph + 2;
+
+  // History of frame times, full height is 33ms
+  for (int i = 0; i < n_frames_; ++i)
+  {
+    int k = (frame_ - n_frames_ + i + history) % history;
+    int h = std::min(graph, int(frame_times_[k] * graph / 33333.0f));
+    olc::Pixel col = (h < graph / 2) ? olc::GREEN : olc::RED;
+    space.DrawLine(x+i, y, x+i, y-h, col);
+  }
+}
+
+#endif
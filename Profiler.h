@@ -0,0 +1,109 @@
+#pragma once
+
+/***********************************************************
+* Frame-time profiler
+* Only compiled if PIXMODELER_PROFILE is defined, otherwise
+* all profiling macros expand to nothing.
+***********************************************************/
+#ifdef PIXMODELER_PROFILE
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+class ModelSpace;
+
+/***********************************************************
+* Phases of a frame that are timed separately
+***********************************************************/
+enum class ProfilePhase {
+  Input,
+  Grid,
+  Cursor,
+  Menu,
+  State,
+  DrawGrid,
+  DrawShapes,
+  Render,
+  DrawMenu,
+  Count
+};
+
+/***********************************************************
+* This class collects the timings of the last frames and
+* draws them as an overlay
+***********************************************************/
+class Profiler
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr int n_phases = int(ProfilePhase::Count);
+  static constexpr int history  = 128;
+
+  /*--------------------------------------------------------
+  | Frame handling
+  --------------------------------------------------------*/
+  void begin_frame();
+  void end_frame();
+  void record(ProfilePhase phase, float us)
+  { phase_times_[int(phase)][frame_] += us; }
+
+  /*--------------------------------------------------------
+  | Overlay
+  --------------------------------------------------------*/
+  void toggle() { visible_ = !visible_; }
+  bool visible() const { return visible_; }
+  void draw(ModelSpace& space);
+
+  /*--------------------------------------------------------
+  | Number of heap allocations since program start
+  --------------------------------------------------------*/
+  static std::size_t allocations();
+
+private:
+  using Samples = std::array<float, history>;
+
+  float percentile(const Samples& s, float q) const;
+
+  std::array<Samples, n_phases> phase_times_ {};
+  Samples           frame_times_  {};
+  Samples           frame_allocs_ {};
+
+  int               frame_        = 0;
+  int               n_frames_     = 0;
+  Clock::time_point frame_start_;
+  std::size_t       alloc_start_  = 0;
+  bool              visible_      = false;
+};
+
+/***********************************************************
+* Timer that adds its lifetime to a profiler phase
+***********************************************************/
+class ScopedTimer
+{
+public:
+  ScopedTimer(Profiler& p, ProfilePhase phase)
+  : profiler_{p}, phase_{phase}, start_{Profiler::Clock::now()} {}
+
+  ~ScopedTimer()
+  {
+    std::chrono::duration<float, std::micro> dt
+      = Profiler::Clock::now() - start_;
+    profiler_.record(phase_, dt.count());
+  }
+
+private:
+  Profiler&                   profiler_;
+  ProfilePhase                phase_;
+  Profiler::Clock::time_point start_;
+};
+
+#define PROFILE_SCOPE(phase) \
+  ScopedTimer profile_timer_(profiler_, ProfilePhase::phase)
+
+#else
+
+#define PROFILE_SCOPE(phase)
+
+#endif
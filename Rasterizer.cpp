@@ -0,0 +1,275 @@
+#include "Rasterizer.h"
+#include "ModelSpace.h"
+#include "Polygon.h"
+#include "Shape.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+/***********************************************************
+* Function to remove all rings
+***********************************************************/
+void Rasterizer::clear()
+{
+  edges_.clear();
+}
+
+/***********************************************************
+* Function to add a closed ring in screen coordinates
+***********************************************************/
+void Rasterizer::add_ring(const std::vector<Vec2f>& ring, bool reverse)
+{
+  int N = ring.size();
+
+  if (N < 3)
+    return;
+
+  for (int i = 0, j = N-1; i < N; j = i++)
+  {
+    if (reverse)
+      edges_.push_back( { ring[i], ring[j] } );
+    else
+      edges_.push_back( { ring[j], ring[i] } );
+  }
+}
+
+/***********************************************************
+* Function to add the outline of a complete shape
+***********************************************************/
+void Rasterizer::add_shape(ModelSpace& space, Shape& s, bool reverse)
+{
+  // Primitives are filled along the outline they are drawn
+  Parametric* prim = dynamic_cast<Parametric*>(&s);
+  const std::vector<Vec2r>* c = prim ? prim->drawn_outline() : nullptr;
+
+  int N = c ? c->size() : s.number_of_nodes();
+
+  if (!s.complete() || N < 3)
+    return;
+
+  auto node = [&](int i)
+  { return c ? (*c)[i] : s.get_node(i)->coords(); };
+
+  Vec2f first, last;
+  space.coord_to_screen(node(0), first);
+  last = first;
+
+  for (int i = 1; i < N; ++i)
+  {
+    Vec2f p;
+    space.coord_to_screen(node(i), p);
+
+    if (reverse)
+      edges_.push_back( { p, last } );
+    else
+      edges_.push_back( { last, p } );
+
+    last = p;
+  }
+
+  if (reverse)
+    edges_.push_back( { first, last } );
+  else
+    edges_.push_back( { last, first } );
+}
+
+/***********************************************************
+* Function to fill all rings into the target
+***********************************************************/
+void Rasterizer::fill(olc::Sprite* target, olc::Pixel color,
+                      FillRule rule)
+{
+  TRACE_ZONE("Rasterizer::fill");
+
+  prepare(target->width, target->height);
+  fill_rows(target, color, rule, 0, target->height);
+}
+
+/***********************************************************
+* Function to set up the edge table for a target size
+***********************************************************/
+void Rasterizer::prepare(int width, int height)
+{
+  table_.clear();
+  order_.clear();
+  bucket_.clear();
+
+  if (width <= 0 || height <= 0 || edges_.empty())
+    return;
+
+  int H = height;
+
+  // Set up all edges, that cross a pixel center within
+  // the target. Scanline y samples at y + 0.5.
+  for (const auto& e : edges_)
+  {
+    Vec2f a = e.a;
+    Vec2f b = e.b;
+    int dir = 1;
+
+    if (a[1] > b[1])
+    {
+      std::swap(a, b);
+      dir = -1;
+    }
+
+    int y_begin = maximum(0, int(std::ceil(a[1] - 0.5f)));
+    int y_end   = minimum(H, int(std::ceil(b[1] - 0.5f)));
+
+    if (y_begin >= y_end)
+      continue;
+
+    float dxdy = (b[0] - a[0]) / (b[1] - a[1]);
+    float x    = a[0] + (y_begin + 0.5f - a[1]) * dxdy;
+
+    table_.push_back( { x, x, dxdy, y_begin, y_end, dir } );
+  }
+
+  if (table_.empty())
+    return;
+
+  // Bucket the edges by their first scanline
+  bucket_.assign(H + 1, 0);
+  for (const auto& e : table_)
+    bucket_[e.y_begin + 1]++;
+  for (int y = 0; y < H; ++y)
+    bucket_[y + 1] += bucket_[y];
+
+  // Place the edges, which moves every bucket start to the
+  // start of the following bucket, and shift back
+  order_.resize(table_.size());
+  for (int i = 0; i < table_.size(); ++i)
+    order_[bucket_[table_[i].y_begin]++] = i;
+  for (int y = H; y > 0; --y)
+    bucket_[y] = bucket_[y - 1];
+  bucket_[0] = 0;
+}
+
+/***********************************************************
+* Function to fill the scanlines [y_begin, y_end) of the 
+* target from the prepared edge table
+***********************************************************/
+void Rasterizer::fill_rows(olc::Sprite* target, olc::Pixel color,
+                           FillRule rule, int y_begin, 
+                           int y_end) const
+{
+  int W = target->width;
+  olc::Pixel* data = target->GetData();
+
+  y_end = minimum(y_end, int(bucket_.size()) - 1);
+
+  if (table_.empty() || y_begin >= y_end)
+    return;
+
+  auto by_x = [](const ActiveEdge& a, const ActiveEdge& b)
+  { return a.x < b.x; };
+
+  std::vector<ActiveEdge> active;
+  std::vector<ActiveEdge> starting;
+  std::vector<ActiveEdge> merged;
+
+  // Edges, that started above the first scanline
+  if (y_begin > 0)
+  {
+    for (const auto& e : table_)
+    {
+      if (e.y_begin < y_begin && e.y_end > y_begin)
+      {
+        active.push_back(e);
+        active.back().x = e.x_begin + (y_begin - e.y_begin) * e.dxdy;
+      }
+    }
+    std::sort(active.begin(), active.end(), by_x);
+  }
+
+  int y = y_begin;
+
+  while (y < y_end)
+  {
+    // Remove the edges, that ended above this scanline
+    int n = 0;
+    for (int i = 0; i < active.size(); ++i)
+      if (active[i].y_end > y)
+        active[n++] = active[i];
+    active.resize(n);
+
+    // Insertion sort, since the order changes only at
+    // crossings of edges
+    for (int i = 1; i < n; ++i)
+    {
+      ActiveEdge e = active[i];
+      int j = i;
+      while (j > 0 && active[j-1].x > e.x)
+      {
+        active[j] = active[j-1];
+        --j;
+      }
+      active[j] = e;
+    }
+
+    // Merge the edges, that start at this scanline
+    if (bucket_[y] < bucket_[y + 1])
+    {
+      starting.clear();
+      for (int k = bucket_[y]; k < bucket_[y + 1]; ++k)
+        starting.push_back(table_[order_[k]]);
+      std::sort(starting.begin(), starting.end(), by_x);
+
+      merged.clear();
+      std::merge(active.begin(), active.end(),
+                 starting.begin(), starting.end(),
+                 std::back_inserter(merged), by_x);
+      active.swap(merged);
+      n = active.size();
+    }
+
+    if (n == 0)
+    {
+      // Skip to the next scanline with edges
+      int k = bucket_[y + 1];
+      if (k >= order_.size())
+        break;
+      y = table_[order_[k]].y_begin;
+      continue;
+    }
+
+    // Fill the spans between entering and leaving the
+    // filled region, edges within the region are skipped
+    olc::Pixel* row = data + y * W;
+    int   winding = 0;
+    float x_in    = 0.0f;
+
+    for (int i = 0; i < n; ++i)
+    {
+      bool was_inside = (rule == FillRule::EvenOdd) ? (winding & 1)
+                                                    : (winding != 0);
+      winding += active[i].dir;
+      bool is_inside  = (rule == FillRule::EvenOdd) ? (winding & 1)
+                                                    : (winding != 0);
+
+      if (is_inside == was_inside)
+        continue;
+
+      if (is_inside)
+      {
+        x_in = active[i].x;
+        continue;
+      }
+
+      int x0 = maximum(0, int(std::ceil(x_in - 0.5f)));
+      int x1 = minimum(W, int(std::ceil(active[i].x - 0.5f)));
+
+      if (x0 < x1)
+        write_span(row, x0, x1, color);
+    }
+
+    // Step to the next scanline. The intersections are
+    // computed from the first one to avoid drift.
+    ++y;
+
+    for (auto& e : active)
+      e.x = e.x_begin + (y - e.y_begin) * e.dxdy;
+  }
+}
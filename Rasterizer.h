@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+
+#include "olc_pixel_game_engine.h"
+#include "Vec2.h"
+#include "Span.h"
+
+class ModelSpace;
+class Shape;
+
+/***********************************************************
+* Rules to decide, which regions of overlapping rings are
+* filled. Even-odd fills regions enclosed by an odd number
+* of rings, non-zero fills regions with a winding number
+* other than zero, such that reversed rings cut holes.
+***********************************************************/
+enum class FillRule { EvenOdd, NonZero };
+
+/***********************************************************
+* Scanline polygon fill with an active edge table.
+*
+* Rings are collected in screen coordinates and filled in
+* a single pass over the scanlines. The edges are bucketed
+* by their first scanline, the active edges are kept sorted
+* by their intersection with the current scanline, which
+* changes only little from one scanline to the next.
+* A pixel is filled if its center lies inside, and every
+* span between two edges is written in one go.
+***********************************************************/
+class Rasterizer
+{
+public:
+  Rasterizer() {}
+  ~Rasterizer() {}
+
+  /*********************************************************
+  * Input rings
+  *********************************************************/
+  void clear();
+
+  // Rings are closed by their last point
+  void add_ring(const std::vector<Vec2f>& ring, bool reverse = false);
+  void add_shape(ModelSpace& space, Shape& s, bool reverse = false);
+
+  /*********************************************************
+  * Rasterization into a sprite, colors with an alpha value
+  * below 255 are blended onto the target
+  *********************************************************/
+  void fill(olc::Sprite* target, olc::Pixel color,
+            FillRule rule = FillRule::NonZero);
+
+  /*********************************************************
+  * Band-wise rasterization: the edge table is set up once
+  * for the target size, afterwards disjoint ranges of 
+  * scanlines may be filled from several threads
+  *********************************************************/
+  void prepare(int width, int height);
+  void fill_rows(olc::Sprite* target, olc::Pixel color,
+                 FillRule rule, int y_begin, int y_end) const;
+
+  int number_of_edges() const { return edges_.size(); }
+
+private:
+  struct Edge
+  {
+    Vec2f a;
+    Vec2f b;
+  };
+
+  struct ActiveEdge
+  {
+    float x;        // Intersection with the current scanline
+    float x_begin;  // Intersection with the first scanline
+    float dxdy;
+    int   y_begin;
+    int   y_end;    // First scanline below the edge
+    int   dir;      // +1 downwards, -1 upwards
+  };
+
+  std::vector<Edge>       edges_;
+
+  // Edge table, that is reused from one fill to the next
+  std::vector<ActiveEdge> table_;
+  std::vector<int>        bucket_;
+  std::vector<int>        order_;
+};
@@ -0,0 +1,262 @@
+#include "Selection.h"
+#include "Shape.h"
+#include "Polygon.h"
+#include "Trace.h"
+
+#include <cmath>
+
+/***********************************************************
+* Affine maps
+***********************************************************/
+Affine Affine::translation(const Vec2r& d)
+{
+  Affine T;
+  T.t = d;
+  return T;
+}
+
+Affine Affine::rotation(float angle, const Vec2r& center)
+{
+  Affine T;
+  Real cs = std::cos(angle);
+  Real sn = std::sin(angle);
+  T.a = cs;  T.b = -sn;
+  T.c = sn;  T.d =  cs;
+  T.t = center - Vec2r { cs * center[0] - sn * center[1],
+                         sn * center[0] + cs * center[1] };
+  return T;
+}
+
+Affine Affine::scaling(float f, const Vec2r& center)
+{
+  Affine T;
+  T.a = f;
+  T.d = f;
+  T.t = center * (1.0f - f);
+  return T;
+}
+
+Affine Affine::mirror(int axis, const Vec2r& center)
+{
+  Affine T;
+  if (axis == 0)
+  {
+    T.a   = -1.0f;
+    T.t[0] = 2.0f * center[0];
+  }
+  else
+  {
+    T.d   = -1.0f;
+    T.t[1] = 2.0f * center[1];
+  }
+  return T;
+}
+
+/***********************************************************
+* Function to clear the selection
+***********************************************************/
+void Selection::clear()
+{
+  groups_.clear();
+  index_.clear();
+  members_.clear();
+}
+
+/***********************************************************
+* Function returns the group of a shape, which is created
+* if the shape has no selected nodes yet
+***********************************************************/
+Selection::Group& Selection::group(Shape* s)
+{
+  auto it = index_.find(s);
+  if (it != index_.end())
+    return groups_[it->second];
+
+  index_[s] = groups_.size();
+  groups_.push_back( Group { s, {} } );
+  return groups_.back();
+}
+
+/***********************************************************
+* Function to add a node to the selection
+***********************************************************/
+void Selection::add(Node* n)
+{
+  if (!members_.insert(n).second)
+    return;
+
+  group(&n->parent()).nodes.push_back(n);
+}
+
+/***********************************************************
+* Function to add all nodes of a shape to the selection
+***********************************************************/
+void Selection::add(Shape* s)
+{
+  Group& g = group(s);
+
+  for (int i = 0; i < s->number_of_nodes(); ++i)
+  {
+    Node* n = s->get_node(i);
+    if (members_.insert(n).second)
+      g.nodes.push_back(n);
+  }
+}
+
+/***********************************************************
+* Function returns the center of the bounding box of all
+* selected nodes
+***********************************************************/
+Vec2r Selection::center() const
+{
+  Vec2r lo, hi;
+  bool found = false;
+
+  for (const auto& g : groups_)
+    for (auto n : g.nodes)
+    {
+      Vec2r c = n->coords();
+      lo = found ? bbox_min(lo, c) : c;
+      hi = found ? bbox_max(hi, c) : c;
+      found = true;
+    }
+
+  return (lo + hi) * 0.5f;
+}
+
+/***********************************************************
+* Function to copy the coordinates of the selected nodes
+* into contiguous arrays
+***********************************************************/
+void Selection::gather()
+{
+  int N = members_.size();
+  x_.resize(N);
+  y_.resize(N);
+
+  int k = 0;
+  for (const auto& g : groups_)
+    for (auto n : g.nodes)
+    {
+      Vec2r c = n->coords();
+      x_[k] = c[0];
+      y_[k] = c[1];
+      ++k;
+    }
+
+  x_old_ = x_;
+  y_old_ = y_;
+}
+
+/***********************************************************
+* Function to write coordinates back onto the selected
+* nodes. The shapes are not invalidated here.
+***********************************************************/
+void Selection::scatter(const std::vector<Real>& x,
+                        const std::vector<Real>& y)
+{
+  int k = 0;
+  for (const auto& g : groups_)
+    for (auto n : g.nodes)
+    {
+      n->coords_ = Vec2r { x[k], y[k] };
+      ++k;
+    }
+}
+
+/***********************************************************
+* Function to apply an affine map onto all selected nodes
+***********************************************************/
+bool Selection::transform(const Affine& T)
+{
+  TRACE_ZONE("Selection::transform");
+
+  if (empty())
+    return true;
+
+  gather();
+
+  // Single pass over the contiguous coordinates
+  int N = x_.size();
+  Real* x = x_.data();
+  Real* y = y_.data();
+  const Real* x0 = x_old_.data();
+  const Real* y0 = y_old_.data();
+
+  for (int i = 0; i < N; ++i)
+  {
+    x[i] = T.a * x0[i] + T.b * y0[i] + T.t[0];
+    y[i] = T.c * x0[i] + T.d * y0[i] + T.t[1];
+  }
+
+  scatter(x_, y_);
+
+  // Shapes are only deformed, if some of their nodes are
+  // not selected. Their cached fixed-point nodes are 
+  // outdated after the scatter.
+  for (const auto& g : groups_)
+  {
+    if (g.nodes.size() == g.shape->number_of_nodes())
+      continue;
+
+    g.shape->invalidate();
+
+    if (!g.shape->valid())
+    {
+      scatter(x_old_, y_old_);
+
+      for (const auto& h : groups_)
+        if (h.nodes.size() != h.shape->number_of_nodes())
+          h.shape->invalidate();
+
+      return false;
+    }
+  }
+
+  bool pure_translation = (T.a == 1.0f && T.b == 0.0f &&
+                           T.c == 0.0f && T.d == 1.0f);
+
+  for (const auto& g : groups_)
+  {
+    Shape* s = g.shape;
+    bool whole = (g.nodes.size() == s->number_of_nodes());
+
+    s->invalidate();
+
+    if (!whole || T.reflects())
+      s->set_orientation(Orient::CCW);
+
+    // Translated primitives keep their parameters
+    Parametric* p = dynamic_cast<Parametric*>(s);
+    if (p && whole && pure_translation)
+      p->moved(T.t);
+  }
+
+  return true;
+}
+
+/***********************************************************
+* Transformations about the center of the selection
+***********************************************************/
+bool Selection::translate(const Vec2r& d)
+{
+  return transform( Affine::translation(d) );
+}
+
+bool Selection::rotate(float angle)
+{
+  return transform( Affine::rotation(angle, center()) );
+}
+
+bool Selection::scale(float f)
+{
+  if (f <= 0.0f)
+    return false;
+
+  return transform( Affine::scaling(f, center()) );
+}
+
+bool Selection::mirror(int axis)
+{
+  return transform( Affine::mirror(axis, center()) );
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Vec2.h"
+
+class Shape;
+class Node;
+
+/***********************************************************
+* Affine map p -> A p + t
+***********************************************************/
+struct Affine
+{
+  Real a = 1.0f, b = 0.0f;
+  Real c = 0.0f, d = 1.0f;
+  Vec2r t;
+
+  static Affine translation(const Vec2r& d);
+  static Affine rotation(float angle, const Vec2r& center);
+  static Affine scaling(float f, const Vec2r& center);
+  static Affine mirror(int axis, const Vec2r& center);
+
+  bool reflects() const { return a * d - b * c < 0.0f; }
+};
+
+/***********************************************************
+* Set of selected nodes, which are transformed together.
+*
+* Selecting a shape selects all of its nodes. The nodes are
+* grouped by their shapes. A transformation gathers
+* their coordinates into contiguous arrays, maps them in a
+* single pass and writes them back. Afterwards, every
+* affected shape is invalidated once. Only shapes with
+* partially selected nodes can become invalid, these are
+* validated and the whole transformation is undone if one
+* of them fails. Reflections restore the orientation of the
+* shapes and update their node indices.
+***********************************************************/
+class Selection
+{
+public:
+  Selection() {}
+  ~Selection() {}
+
+  void clear();
+  void add(Node* n);
+  void add(Shape* s);
+
+  bool contains(const Node* n) const
+  { return members_.count(n) > 0; }
+  bool contains(const Shape* s) const
+  { return index_.count(s) > 0; }
+
+  bool empty() const { return members_.empty(); }
+  int number_of_nodes() const { return members_.size(); }
+  int number_of_shapes() const { return groups_.size(); }
+
+  // Selected nodes of a shape
+  struct Group
+  {
+    Shape*              shape;
+    std::vector<Node*>  nodes;
+  };
+
+  const std::vector<Group>& groups() const { return groups_; }
+
+  // Center of the bounding box of the selected nodes
+  Vec2r center() const;
+
+  /*********************************************************
+  * Batched transformations. Return false and leave the
+  * nodes unchanged, if a shape would become invalid.
+  *********************************************************/
+  bool transform(const Affine& T);
+  bool translate(const Vec2r& d);
+  bool rotate(float angle);
+  bool scale(float f);
+  bool mirror(int axis);
+
+private:
+  std::vector<Group>                      groups_;
+  std::unordered_map<const Shape*, int>   index_;
+  std::unordered_set<const Node*>         members_;
+
+  // Coordinates of the nodes in the order of the groups,
+  // before and after a transformation
+  std::vector<Real>   x_, y_;
+  std::vector<Real>   x_old_, y_old_;
+
+  Group& group(Shape* s);
+  void gather();
+  void scatter(const std::vector<Real>& x,
+               const std::vector<Real>& y);
+};
@@ -1,13 +1,55 @@
 #include "Shape.h"
 #include "ModelSpace.h"
 #include "Polygon.h"
+#include "Trace.h"
+#include "Job.h"
 
-#include <iostream>
-#include <iomanip>
 #include <cstdio>
+#include <cmath>
+#include <limits>
 
 
 
+/***********************************************************
+* Function to check if the segments (t_1,t_2) and (b_1,b_2)
+* intersect or touch. Works on floating point as well as on
+* exact fixed-point coordinates.
+***********************************************************/
+template <typename V>
+static bool segments_touch(const V& t_1, const V& t_2, 
+                           const V& b_1, const V& b_2)
+{
+  Orient o1 = orientation(t_1, t_2, b_1);
+  Orient o2 = orientation(t_1, t_2, b_2);
+  Orient o3 = orientation(b_1, b_2, t_1);
+  Orient o4 = orientation(b_1, b_2, t_2);
+
+  if (  ( (o1 == Orient::CCW && o2 == Orient::CW ) ||
+          (o1 == Orient::CW  && o2 == Orient::CCW) ) 
+    &&  ( (o3 == Orient::CCW && o4 == Orient::CW ) ||
+          (o3 == Orient::CW  && o4 == Orient::CCW) ) )
+    return true;
+
+  // (t_1,t_2) and b_1 are collinear 
+  // and b_1 lies on segment (t_1,t_2)
+  if ( (o1 == Orient::CL) && in_on_segment(t_1,t_2,b_1) )
+    return true;
+  // (t_1,t_2) and b_2 are collinear 
+  // and b_2 lies on segment (t_1,t_2)
+  if ( (o2 == Orient::CL) && in_on_segment(t_1,t_2,b_2) )
+    return true;
+  // (b_1,b_2) and t_1 are collinear 
+  // and t_1 lies on segment (b_1,b_2)
+  if ( (o3 == Orient::CL) && in_on_segment(b_1,b_2,t_1) )
+    return true;
+  // (b_1,b_2) and t_2 are collinear 
+  // and t_2 lies on segment (b_1,b_2)
+  if ( (o4 == Orient::CL) && in_on_segment(b_1,b_2,t_2) )
+    return true;
+
+  return false;
+}
+
 /***********************************************************
 * Weiler-Atherthon algorithm for the estimation of polygon
 * intersections
@@ -20,59 +62,45 @@
 * References: 
 * https://www.geeksforgeeks.org/weiler-atherton-polygon-clipping-algorithm/
 ***********************************************************/
-IntersectData* prepare_poly_intersection(Shape* t, Shape *b)
+IntersectData* prepare_poly_intersection(Shape* t, Shape *b,
+                                         JobControl* ctl)
 {
+  TRACE_ZONE("prepare_poly_intersection");
+
   int Nt = t->number_of_nodes();
   int Nb = b->number_of_nodes();
 
-  std::vector<Vec2f> intersecs;
+  std::vector<Vec2r> intersecs;
   std::vector<int> t_intersec_index;
   std::vector<int> b_intersec_index;
 
+  const std::vector<Vec2l>* ft = t->fixed_nodes();
+  const std::vector<Vec2l>* fb = b->fixed_nodes();
+
   for (int i = 0; i < Nt; ++i)
   {
-    Vec2f t_1 = t->get_node(i)->coords();
-    Vec2f t_2 = t->get_node((i+1)%Nt)->coords();
+    if (ctl)
+    {
+      if (ctl->cancelled())
+        return nullptr;
+      ctl->progress( float(i) / Nt );
+    }
+
+    Vec2r t_1 = t->get_node(i)->coords();
+    Vec2r t_2 = t->get_node((i+1)%Nt)->coords();
 
     for (int j = 0; j < Nb; ++j)
     {
-      Vec2f b_1 = b->get_node(j)->coords();
-      Vec2f b_2 = b->get_node((j+1)%Nb)->coords();
+      Vec2r b_1 = b->get_node(j)->coords();
+      Vec2r b_2 = b->get_node((j+1)%Nb)->coords();
 
       /*----------------------------------------------------
-      | Check for intersections
+      | Check for intersections, exactly on grid nodes
       ----------------------------------------------------*/
-      bool intersect = false;
-
-      Orient o1 = orientation(t_1, t_2, b_1);
-      Orient o2 = orientation(t_1, t_2, b_2);
-      Orient o3 = orientation(b_1, b_2, t_1);
-      Orient o4 = orientation(b_1, b_2, t_2);
-
-      if (  ( (o1 == Orient::CCW && o2 == Orient::CW ) ||
-              (o1 == Orient::CW  && o2 == Orient::CCW) ) 
-        &&  ( (o3 == Orient::CCW && o4 == Orient::CW ) ||
-              (o3 == Orient::CW  && o4 == Orient::CCW) ) )
-      {
-        intersect = true;
-      }
-
-      // (t_1,t_2) and b_1 are collinear 
-      // and b_2 lies on segment (t_1,t_2)
-      if ( (o1 == Orient::CL) && in_on_segment(t_1,t_2,b_1) )
-        intersect = true;
-      // (t_1,t_2) and b_2 are collinear 
-      // and b_1 lies on segment (t_1,t_2)
-      if ( (o2 == Orient::CL) && in_on_segment(t_1,t_2,b_2) )
-        intersect = true;
-      // (b_1,b_2) and t_1 are collinear 
-      // and t_2 lies on segment (b_1,b_2)
-      if ( (o3 == Orient::CL) && in_on_segment(b_1,b_2,t_1) )
-        intersect = true;
-      // (b_1,b_2) and t_1 are collinear 
-      // and t_2 lies on segment (b_1,b_2)
-      if ( (o4 == Orient::CL) && in_on_segment(b_1,b_2,t_2) )
-        intersect = true;
+      bool intersect = (ft && fb)
+        ? segments_touch((*ft)[i], (*ft)[(i+1)%Nt], 
+                         (*fb)[j], (*fb)[(j+1)%Nb])
+        : segments_touch(t_1, t_2, b_1, b_2);
 
       /*----------------------------------------------------
       | Intersection detected
@@ -80,15 +108,15 @@ IntersectData* prepare_poly_intersection(Shape* t, Shape *b)
       if ( intersect )
       {
         // Compute point of intersection
-        Vec2f dt = t_2 - t_1;
-        Vec2f db = b_2 - b_1;
-        Vec2f tb = b_1 - t_1;
-        float d = cross(dt, db);
+        Vec2r dt = t_2 - t_1;
+        Vec2r db = b_2 - b_1;
+        Vec2r tb = b_1 - t_1;
+        Real d = cross(dt, db);
         if (fabs(d) < geometry_small)
           continue;
 
-        float t = cross( tb, db) / d;
-        Vec2f m_ts = t_1 + dt * t;
+        Real t = cross( tb, db) / d;
+        Vec2r m_ts = t_1 + dt * t;
 
         bool already_found = false;
         for (auto ints : intersecs)
@@ -184,21 +212,7 @@ IntersectData* prepare_poly_intersection(Shape* t, Shape *b)
   data->Nt = data->t_list.size();
   data->Nb = data->b_list.size();
 
-  // Now start with algorithm and create new polygons
-  std::cout << std::fixed << std::setprecision(2);
-  std::cout << "\n--- Top shape ---\n";
-  for (int i = 0; i < data->Nt; i++)
-    std::cout << "Index: " << i << " - " << data->t_list[i] 
-      << " - intersection: " << data->t_intersec[i] 
-      << " - link: " << data->t_link[i] << "\n";
-
-  std::cout << "\n--- Bottom shape ---\n";
-  for (int i = 0; i < data->Nb; i++)
-    std::cout << "Index: " << i << " - " << data->b_list[i] 
-      << " - intersection: " << data->b_intersec[i]  
-      << " - link: " << data->b_link[i] << "\n";
-
- return data;
+  return data;
 }
 
 
@@ -215,8 +229,9 @@ void Shape::draw_nodes()
     Node n = *nodes_[i];
     int sx, sy;
     space_.coord_to_screen(n.coords(), sx, sy);
-    space_.FillCircle(sx, sy, 2, olc::RED);
-    space_.DrawString(sx+3, sy+3, std::to_string(n.index()), olc::WHITE);
+    space_.renderer().fill_circle(sx, sy, 2, olc::RED);
+    space_.renderer().draw_string(sx+3, sy+3, std::to_string(n.index()), 
+                                  olc::WHITE);
   }
 }
 
@@ -225,23 +240,22 @@ void Shape::draw_nodes()
 ***********************************************************/
 void Shape::draw()
 {
-  int sx, sy; 
-  int ex, ey;
+  Vec2f s, e;
 
   if (nodes_.size() > 1)
   {
     for (int i = 1; i < nodes_.size(); ++i)
     {
-      space_.coord_to_screen(nodes_[i-1]->coords(), sx, sy);
-      space_.coord_to_screen(nodes_[i]->coords(), ex, ey);
-      space_.DrawLine(sx, sy, ex, ey, color_);
+      space_.coord_to_screen(nodes_[i-1]->coords(), s);
+      space_.coord_to_screen(nodes_[i]->coords(), e);
+      space_.renderer().draw_line_aa(s, e, color_);
     }
 
     if (complete_)
     {
-      space_.coord_to_screen(nodes_[nodes_.size()-1]->coords(), sx, sy);
-      space_.coord_to_screen(nodes_[0]->coords(), ex, ey);
-      space_.DrawLine(sx, sy, ex, ey, color_);
+      space_.coord_to_screen(nodes_[nodes_.size()-1]->coords(), s);
+      space_.coord_to_screen(nodes_[0]->coords(), e);
+      space_.renderer().draw_line_aa(s, e, color_);
     }
   }
 }
@@ -253,45 +267,114 @@ void Shape::draw()
 ***********************************************************/
 bool Shape::valid()
 {
-  int N = nodes_.size();
+  TRACE_ZONE("Shape::valid");
+
+  int i, j;
+  return !self_intersection(i, j);
+}
+
+/***********************************************************
+* Coordinates of the nodes of a shape, which are accessed
+* like a vector of points without copying them
+***********************************************************/
+struct NodeCoords
+{
+  const std::vector<Node*>& nodes;
+
+  int   size() const { return nodes.size(); }
+  Vec2r operator[](int i) const { return nodes[i]->coords(); }
+  Vec2r back() const { return nodes.back()->coords(); }
+};
+
+/***********************************************************
+* Function to search for intersecting edges of the closed
+* polygon c, on floating point or fixed-point coordinates
+***********************************************************/
+template <typename C>
+static bool find_self_intersection(const C& c, int& i_edge, int& j_edge)
+{
+  int N = c.size();
 
   // Check if segments intersects within polygon
   if (N > 1)
   {
     for (int i = 0; i < N-2; ++i)
     {
-      Vec2f m = nodes_[i]->coords();
-      Vec2f n = nodes_[i+1]->coords();
+      const auto m = c[i];
+      const auto n = c[i+1];
 
       for (int j = i+2; j < i+N-1; ++j)
       {
         if (j%N == 0)
           break;
 
-        Vec2f p = nodes_[j%N]->coords();
-        Vec2f q = nodes_[(j+1)%N]->coords();
+        const auto p = c[j%N];
+        const auto q = c[(j+1)%N];
 
-        if ( line_intersection(p,q,m,n) )
-          return false;
-        
-        if (m == p || m == q || n == p || n == q)
-          return false;
+        if ( line_intersection(p,q,m,n) ||
+             m == p || m == q || n == p || n == q )
+        {
+          i_edge = i;
+          j_edge = j%N;
+          return true;
+        }
       }
     }
   }
 
-  return true;
+  return false;
+}
+
+/***********************************************************
+* Function to search for intersecting shape edges. 
+* Returns true, if the edges starting at node i and j
+* intersect or share a node. Shapes on the fixed-point 
+* grid are checked exactly.
+***********************************************************/
+bool Shape::self_intersection(int& i_edge, int& j_edge)
+{
+  if (const std::vector<Vec2l>* f = fixed_nodes())
+    return find_self_intersection(*f, i_edge, j_edge);
 
+  return find_self_intersection(NodeCoords{nodes_}, i_edge, j_edge);
+}
+
+/***********************************************************
+* Function returns the coordinates of all nodes
+***********************************************************/
+std::vector<Vec2r> Shape::coords() const
+{
+  std::vector<Vec2r> c;
+  c.reserve(nodes_.size());
+  for (auto n : nodes_)
+    c.push_back(n->coords());
+  return c;
 }
 
 
+/***********************************************************
+* Function to check if the segment from the last point of 
+* the open chain c to the point n crosses the chain
+***********************************************************/
+template <typename C, typename V>
+static bool chain_crossed(const C& c, const V& n)
+{
+  const V m = c.back();
+
+  for (int i = 1; i < c.size(); ++i)
+    if ( line_intersection(c[i-1], c[i], m, n) )
+      return true;
+
+  return false;
+}
+
 /***********************************************************
 * Function to add a new node to the shape 
 * Every shape is a list of nodes. The last node is 
 * connected to the first one.
 * The shape edges must not intersect.
 ***********************************************************/
-Node* Shape::add_node(const Vec2f& n)
+Node* Shape::add_node(const Vec2r& n)
 {
   // Complete shape if new node is first node
   // Adjust orientation of shape is needed
@@ -316,16 +399,12 @@ Node* Shape::add_node(const Vec2f& n)
   // Check if new segment intersects with polygon
   if (nodes_.size() > 1 && !complete_)
   {
-    Vec2f m = nodes_[nodes_.size()-1]->coords();
+    const std::vector<Vec2l>* f = fixed_nodes();
+    Vec2l n_f;
 
-    for (int i = 1; i < nodes_.size(); ++i)
-    {
-      Vec2f p = nodes_[i-1]->coords();
-      Vec2f q = nodes_[i]->coords();
-
-      if ( line_intersection(p,q,m,n) )
-        return nullptr;
-    }
+    if ( f && to_fixed(n, n_f) ? chain_crossed(*f, n_f)
+                               : chain_crossed(NodeCoords{nodes_}, n) )
+      return nullptr;
   }
 
   // Ignore query if shape is already complete
@@ -335,6 +414,7 @@ Node* Shape::add_node(const Vec2f& n)
   // Else create new node and add to shape
   int index = nodes_.size();
   nodes_.push_back( new Node {*this, index, n} );
+  node_inserted(index);
   return nodes_[nodes_.size()-1];
 }
 
@@ -343,7 +423,7 @@ Node* Shape::add_node(const Vec2f& n)
 * element with index 
 * Works only on complete shapes
 ***********************************************************/
-Node* Shape::add_node(int index, const Vec2f& n)
+Node* Shape::add_node(int index, const Vec2r& n)
 {
   if (!complete_)
     return nullptr;
@@ -357,7 +437,10 @@ Node* Shape::add_node(int index, const Vec2f& n)
   // Update indices of nodes 
   for (int i = index+1; i < nodes_.size(); i++)
     nodes_[i]->index(i);
+
+  node_inserted(index);
   
+  return nodes_[index];
 }
 
 /***********************************************************
@@ -368,38 +451,210 @@ void Shape::rem_node(int index)
   if ( index >= nodes_.size() || index < 0)
     return;
   
+  Vec2r c = nodes_[index]->coords();
+
+  delete nodes_[index];
   nodes_.erase( nodes_.begin()+index );
 
   for (int i = index; i < nodes_.size(); i++)
     nodes_[i]->index(i);
+
+  node_removed(index, c);
+}
+
+/***********************************************************
+* Function to remove all nodes, which are marked in the 
+* given vector, and to renumber the remaining ones at once
+***********************************************************/
+void Shape::rem_nodes(const std::vector<bool>& removed)
+{
+  int k = 0;
+  for (int i = 0; i < nodes_.size(); ++i)
+  {
+    if (i < removed.size() && removed[i])
+    {
+      delete nodes_[i];
+      continue;
+    }
+
+    nodes_[i]->index(k);
+    nodes_[k++] = nodes_[i];
+  }
+
+  if (k == nodes_.size())
+    return;
+
+  nodes_.resize(k);
+  invalidate();
+}
+
+/***********************************************************
+* Function to find the nodes of the closed polygon c, 
+* which remain after removing duplicate and collinear 
+* nodes. The kept nodes are collected on a stack, whose
+* top is removed as long as it lies on a line with its
+* predecessor and the next node. Afterwards, the ends of 
+* the stack are joined. Every node is pushed and popped at
+* most once.
+* Returns the indices of the kept nodes from first on.
+***********************************************************/
+template <typename V, typename Same, typename Collinear>
+static void straighten(const std::vector<V>& c, 
+                       Same same, Collinear collinear,
+                       std::vector<int>& kept, int& first)
+{
+  kept.clear();
+  first = 0;
+
+  for (int i = 0; i < c.size(); ++i)
+  {
+    if (!kept.empty() && same(c[kept.back()], c[i]))
+      continue;
+
+    while ( kept.size() >= 2 && 
+            collinear(c[kept[kept.size()-2]], c[kept.back()], c[i]) )
+      kept.pop_back();
+
+    kept.push_back(i);
+  }
+
+  bool changed = true;
+
+  while (changed && kept.size() - first >= 3)
+  {
+    int n   = kept.size();
+    int a   = kept[n-2];
+    int b   = kept[n-1];
+    int c_0 = kept[first];
+    int c_1 = kept[first+1];
+
+    changed = true;
+
+    if ( same(c[b], c[c_0]) || collinear(c[a], c[b], c[c_0]) )
+      kept.pop_back();
+    else if ( collinear(c[b], c[c_0], c[c_1]) )
+      ++first;
+    else
+      changed = false;
+  }
+}
+
+/***********************************************************
+* Function to remove duplicate nodes and nodes on a 
+* straight line between their neighbors in linear time.
+* Shapes on the fixed-point grid are checked exactly, 
+* others within the rounding error of their coordinates. 
+* Shapes, which would degenerate, are left unchanged.
+***********************************************************/
+int Shape::normalize()
+{
+  TRACE_ZONE("Shape::normalize");
+
+  int N = nodes_.size();
+  if (N <= 3)
+    return 0;
+
+  std::vector<int> kept;
+  int first = 0;
+
+  if (const std::vector<Vec2l>* f = fixed_nodes())
+  {
+    straighten(*f, 
+      [](const Vec2l& p, const Vec2l& q) { return p == q; },
+      [](const Vec2l& p, const Vec2l& q, const Vec2l& r)
+      { return ::orientation(p, q, r) == Orient::CL; },
+      kept, first);
+  }
+  else
+  {
+    std::vector<Vec2r> c = coords();
+
+    Real magnitude = 0.0f;
+    for (const auto& p : c)
+      magnitude = maximum(magnitude, maximum(std::fabs(p[0]), 
+                                             std::fabs(p[1])));
+
+    Real tol = 8.0f * std::numeric_limits<Real>::epsilon() * magnitude;
+
+    // Nodes are collinear, if the height of their triangle
+    // is within the tolerance
+    straighten(c, 
+      [tol](const Vec2r& p, const Vec2r& q) 
+      { return (q - p).length_squared() <= tol * tol; },
+      [tol](const Vec2r& p, const Vec2r& q, const Vec2r& r)
+      { 
+        Real a = cross(q - p, r - p);
+        Real l = maximum( (q - p).length_squared(), 
+                 maximum( (r - q).length_squared(),
+                          (r - p).length_squared() ) );
+        return a * a <= tol * tol * l;
+      },
+      kept, first);
+  }
+
+  int n = kept.size() - first;
+  if (n == N || n < 3)
+    return 0;
+
+  std::vector<bool> removed(N, true);
+  for (int k = first; k < kept.size(); ++k)
+    removed[kept[k]] = false;
+
+  rem_nodes(removed);
+
+  return N - n;
+}
+
+/***********************************************************
+* Function to return the turn of the closed polygon c at
+* its lowest node, the leftmost one among equally low 
+* nodes. The node lies on the convex hull, so the turn is
+* the orientation of a simple polygon.
+***********************************************************/
+template <typename C>
+static Orient lowest_turn(const C& c)
+{
+  int N = c.size();
+  if (N < 3)
+    return Orient::CL;
+
+  int k = 0;
+  for (int i = 1; i < N; ++i)
+    if ( c[i][1] < c[k][1] || (c[i][1] == c[k][1] && c[i][0] < c[k][0]) )
+      k = i;
+
+  return orientation(c[(k+N-1)%N], c[k], c[(k+1)%N]);
 }
 
 /***********************************************************
 * Function to check the shape for its orientation. If
 * it is not oriented counter-clockwise, the nodes are 
-* rearranged
+* rearranged. The orientation is decided by the predicates
+* at the lowest node, exactly for shapes on the fixed-point
+* grid. The sign of the cached area, which accumulates 
+* rounding errors of single node edits, is only used for 
+* collinear turns. Reversing only negates the cached sums.
 ***********************************************************/
 void Shape::set_orientation(Orient orient)
 {
+  TRACE_ZONE("Shape::set_orientation");
+
   int N = nodes_.size();
-  int cw_turns = 0;
-  int ccw_turns = 0;
 
-  for (int i = 0; i < N; ++i)
-  {
-    Vec2f p = nodes_[i]->coords();
-    Vec2f q = nodes_[(i+1)%N]->coords();
-    Vec2f r = nodes_[(i+2)%N]->coords();
+  const std::vector<Vec2l>* f = fixed_nodes();
+  Orient o = f ? lowest_turn(*f) : lowest_turn(NodeCoords{nodes_});
+
+  if (o == Orient::CL)
+    o = orientation();
 
-    if (orientation(p, q, r) == Orient::CCW)
-      ccw_turns++;
-    else if (orientation(p, q, r) == Orient::CW)
-      cw_turns++;
-  }
   // Re-orientation 
-  if ( (orient == Orient::CCW && cw_turns > ccw_turns) ||
-       (orient == Orient::CW && ccw_turns > cw_turns) )
+  if ( (orient == Orient::CCW && o == Orient::CW) ||
+       (orient == Orient::CW && o == Orient::CCW) )
   {
+    outdate();
+    area2_  = -area2_;
+    moment_ = -moment_;
+
     for (int i = 1; i < int(ceil(N/2.)); ++i)
     {
       Node* tmp = nodes_[i];
@@ -417,6 +672,8 @@ void Shape::set_orientation(Orient orient)
 ***********************************************************/
 bool Shape::contains_shape(Shape* s)
 {
+  TRACE_ZONE("Shape::contains_shape");
+
   for (int i = 0; i < s->number_of_nodes(); ++i)
     if (!contains_node(s->get_node(i)->coords()))
       return false;
@@ -427,8 +684,10 @@ bool Shape::contains_shape(Shape* s)
 * Function to clip this shape on another shape b.
 * Returns pointer to a vector of all resulting new shapes
 ***********************************************************/
-std::vector<Shape*> Shape::clip(Shape* s)
+std::vector<Shape*> Shape::clip(Shape* s, JobControl* ctl)
 {
+  TRACE_ZONE("Shape::clip");
+
   std::vector<Shape*> new_shapes;
 
   if (!s || !complete_ || !s->complete() || s == this)
@@ -444,18 +703,59 @@ std::vector<Shape*> Shape::clip(Shape* s)
   | Find all intersection points and mark them as 
   | entering or exiting
   --------------------------------------------------------*/
-  IntersectData* intersec = prepare_poly_intersection(this, s);
+  IntersectData* intersec = prepare_poly_intersection(this, s, ctl);
   
   return new_shapes;
 }
 
+/***********************************************************
+* Function to offset this shape by a distance. 
+* Returns the new shapes, whose edges deviate less than
+* max_error from round joins.
+***********************************************************/
+std::vector<Shape*> Shape::offset(Real distance, JoinType join,
+                                  Real max_error, JobControl* ctl)
+{
+  TRACE_ZONE("Shape::offset");
+
+  std::vector<Shape*> new_shapes;
+
+  if (!complete_ || nodes_.size() < 3)
+    return new_shapes;
+
+  std::vector<std::vector<Vec2r>> outer;
+  std::vector<std::vector<Vec2r>> holes;
+
+  if (!offset_polygon(coords(), distance, join, max_error, 
+                      outer, holes, ctl))
+    return new_shapes;
+
+  // Indices are assigned, once the shapes are added to the
+  // model space on the main thread
+  for (auto loops : {&outer, &holes})
+  {
+    bool extr = (loops == &outer) ? exteriror_ : !exteriror_;
+
+    for (const auto& c : *loops)
+    {
+      Shape* s = new Polygon(space_, -1, extr, c);
+      s->normalize();
+      new_shapes.push_back(s);
+    }
+  }
+
+  return new_shapes;
+}
+
 /***********************************************************
 * Function to merge this shape with another one.
 * Returns pointer to a new shape
 * --> Weiler-Atherton Algorithm
 ***********************************************************/
-Shape* Shape::merge(Shape* s)
+Shape* Shape::merge(Shape* s, JobControl* ctl)
 {
+  TRACE_ZONE("Shape::merge");
+
   if (!s || !complete_ || !s->complete())
     return nullptr;
 
@@ -487,15 +787,11 @@ Shape* Shape::merge(Shape* s)
     return nullptr;
 
   /*--------------------------------------------------------
-  | Init a new shape
+  | Init a new shape. Merges run on worker threads, so the
+  | index is assigned once the shape is added to the model
+  | space.
   --------------------------------------------------------*/
-  int new_index = -1;
-  if (exteriror_)
-    new_index = space_.number_of_extr_shapes();
-  else
-    new_index = space_.number_of_intr_shapes();
-
-  Polygon* new_poly = new Polygon(space_, new_index, exteriror_);
+  Polygon* new_poly = new Polygon(space_, -1, exteriror_);
   new_poly->add_node(start->coords());
 
   /*--------------------------------------------------------
@@ -510,6 +806,14 @@ Shape* Shape::merge(Shape* s)
   int i = 0;
   int intersections = 0;
 
+  // Every step advances by one node of either shape or by
+  // one intersection. The boundary of the union of two
+  // simple polygons passes a near-linear number of 
+  // intersections, so a valid traversal ends within a 
+  // linear number of steps.
+  int64_t step = 0;
+  int64_t max_steps = 4 * (int64_t(N_a) + N_b) + 4;
+
   // Init states of all edges
   for (int i = 0; i < N_a; ++i)
     a->get_node(i)->state(Node::State::Unvisited);
@@ -519,28 +823,40 @@ Shape* Shape::merge(Shape* s)
   // Traverse shape a
   do
   {
-    Vec2f p_a = a->nodes_[i%N_a]->coords();
-    Vec2f pr_a = a->nodes_[(i+1)%N_a]->coords();
+    if (ctl)
+    {
+      if (ctl->cancelled())
+      {
+        delete new_poly;
+        return nullptr;
+      }
+      // Estimate: the merged shape holds about N_a+N_b nodes
+      ctl->progress( minimum(0.99f, float(new_poly->number_of_nodes()) 
+                                    / (N_a+N_b)) );
+    }
+
+    Vec2r p_a = a->nodes_[i%N_a]->coords();
+    Vec2r pr_a = a->nodes_[(i+1)%N_a]->coords();
 
     // Traverse shape b
     for (int j = 0; j < N_b; j++)
     {
-      Vec2f p_b = b->nodes_[j]->coords();
-      Vec2f pr_b = b->nodes_[(j+1)%N_b]->coords();
+      Vec2r p_b = b->nodes_[j]->coords();
+      Vec2r pr_b = b->nodes_[(j+1)%N_b]->coords();
 
       // Check for intersection
       if ( line_intersection(p_a,pr_a, p_b,pr_b) )
       {
         // Ignore if intersecting lines are colinear
-        if (orientation(p_a, pr_a, p_b) == Orient::CL &&
-            orientation(p_a, pr_a, pr_b) == Orient::CL)
+        if (::orientation(p_a, pr_a, p_b) == Orient::CL &&
+            ::orientation(p_a, pr_a, pr_b) == Orient::CL)
             break;
 
         // Compute point of intersection
-        Vec2f r_a = pr_a - p_a;
-        Vec2f r_b = pr_b - p_b;
-        float t = cross( p_a-p_b, r_b / cross(r_a, r_b) );
-        Vec2f m = p_a - r_a * t;
+        Vec2r r_a = pr_a - p_a;
+        Vec2r r_b = pr_b - p_b;
+        Real t = cross( p_a-p_b, r_b / cross(r_a, r_b) );
+        Vec2r m = p_a - r_a * t;
 
         // If edge was not visited yet -> outgoing
         if (b->nodes_[j]->state() == Node::State::Unvisited)
@@ -582,40 +898,426 @@ Shape* Shape::merge(Shape* s)
     new_poly->add_node(pr_a);
     i++;
 
-  } while (a->nodes_[i%N_a] != start);
+  } while (a->nodes_[i%N_a] != start && ++step < max_steps);
 
-  // No intersection occured -> delete shape
-  if (intersections == 0)
+  // No intersection occured or traversal did not 
+  // return to its start -> delete shape
+  if (intersections == 0 || step >= max_steps)
   {
     delete new_poly;
     new_poly = nullptr;
   }
+  // Intersections often lie on a line with their neighbors
+  else
+    new_poly->normalize();
 
   return new_poly;
 }
 
 
 /***********************************************************
-* Function to check if a node is contained inside the shape
+* Function returns a copy of the shape with its own nodes,
+* which can be processed independently of the original
+***********************************************************/
+Shape* Shape::snapshot()
+{
+  Polygon* copy = new Polygon(space_, -1, exteriror_);
+
+  for (auto n : nodes_)
+    copy->nodes_.push_back( new Node {*copy, n->index(), n->coords()} );
+
+  copy->complete_ = complete_;
+  copy->color_    = color_;
+
+  return copy;
+}
+
+/***********************************************************
+* Function to mark the cached data of the shape and the
+* model space as outdated
+***********************************************************/
+void Shape::invalidate()
+{
+  outdate();
+  measured_ = false;
+  bounded_  = false;
+}
+
+/***********************************************************
+* Function to mark the cached data, which is not updated
+* along with single nodes, and the model space as outdated
+***********************************************************/
+void Shape::outdate()
+{
+  triangulated_  = false;
+  hulled_        = false;
+  decomposed_    = false;
+  fixed_checked_ = false;
+  revision_ = (index_ < 0) ? revision_ + 1 : space_.modified();
+}
+
+/***********************************************************
+* Function to set the index of the shape in the model 
+* space. A shape, which is added to the model space, takes
+* a new revision of the model space.
+***********************************************************/
+void Shape::index(int i)
+{
+  if (index_ < 0 && i >= 0)
+    revision_ = space_.modified();
+
+  index_ = i;
+}
+
+/***********************************************************
+* Function to add the contributions of the edge (p,q) to
+* the geometric properties, or to subtract them for a 
+* negative sign. The edge is taken relative to ref_, such
+* that the cross products keep their precision far from 
+* the origin.
+***********************************************************/
+void Shape::add_edge(const Vec2r& p, const Vec2r& q, double sign)
+{
+  Vec2d a = Vec2d { p[0], p[1] } - ref_;
+  Vec2d b = Vec2d { q[0], q[1] } - ref_;
+  double c = sign * cross(a, b);
+
+  area2_     += c;
+  moment_    += (a + b) * c;
+  perimeter_ += sign * (b - a).length();
+}
+
+/***********************************************************
+* Function to sum up the geometric properties of all edges
 ***********************************************************/
-bool Shape::contains_node(const Vec2f& n)
+void Shape::measure()
 {
   int N = nodes_.size();
-  for (int i = 0; i < N; i++)
+
+  area2_     = 0.0;
+  perimeter_ = 0.0;
+  moment_    = {0.0, 0.0};
+
+  if (N > 0)
   {
-    Vec2f p = nodes_[i]->coords();
-    Vec2f q = nodes_[(i+1)%N]->coords();
-    if (!is_left(p,q,n))
-      return false;
+    Vec2r p = nodes_[0]->coords();
+    ref_ = Vec2d { p[0], p[1] };
+  }
+
+  for (int i = 0; i < N; ++i)
+    add_edge(nodes_[i]->coords(), nodes_[(i+1)%N]->coords(), 1.0);
+
+  measured_ = true;
+}
+
+/***********************************************************
+* Function to update the geometric properties after a node 
+* has been inserted at index, which replaces the edge 
+* between its neighbors
+***********************************************************/
+void Shape::node_inserted(int index)
+{
+  outdate();
+
+  int N = nodes_.size();
+  Vec2r c = nodes_[index]->coords();
+
+  if (N < 2)
+  {
+    measured_ = false;
+    bounded_  = false;
+    return;
+  }
+
+  if (measured_)
+  {
+    Vec2r p = nodes_[(index+N-1)%N]->coords();
+    Vec2r q = nodes_[(index+1)%N]->coords();
+
+    add_edge(p, q, -1.0);
+    add_edge(p, c, 1.0);
+    add_edge(c, q, 1.0);
+  }
+
+  if (bounded_)
+  {
+    bb_lo_ = bbox_min(bb_lo_, c);
+    bb_hi_ = bbox_max(bb_hi_, c);
+  }
+}
+
+/***********************************************************
+* True, if the bounding box (lo,hi) may shrink, when the 
+* point from on its boundary moves to c
+***********************************************************/
+static bool shrinks(const Vec2r& lo, const Vec2r& hi,
+                    const Vec2r& from, const Vec2r& c)
+{
+  return (from[0] == lo[0] && c[0] > lo[0])
+      || (from[0] == hi[0] && c[0] < hi[0])
+      || (from[1] == lo[1] && c[1] > lo[1])
+      || (from[1] == hi[1] && c[1] < hi[1]);
+}
+
+/***********************************************************
+* Function to update the geometric properties after the 
+* node with coordinates c has been removed from index.
+* The bounding box is only recomputed, if the node was on
+* its boundary.
+***********************************************************/
+void Shape::node_removed(int index, const Vec2r& c)
+{
+  outdate();
+
+  int N = nodes_.size();
+
+  if (N < 1)
+  {
+    measured_ = false;
+    bounded_  = false;
+    return;
+  }
+
+  if (measured_)
+  {
+    Vec2r p = nodes_[(index+N-1)%N]->coords();
+    Vec2r q = nodes_[index%N]->coords();
+
+    add_edge(p, c, -1.0);
+    add_edge(c, q, -1.0);
+    add_edge(p, q, 1.0);
+  }
+
+  if ( bounded_ && (c[0] == bb_lo_[0] || c[0] == bb_hi_[0] ||
+                    c[1] == bb_lo_[1] || c[1] == bb_hi_[1]) )
+    bounded_ = false;
+}
+
+/***********************************************************
+* Function to update the geometric properties after the 
+* node n has been moved away from the coordinates from
+***********************************************************/
+void Shape::node_moved(const Node* n, const Vec2r& from)
+{
+  outdate();
+
+  int i = n->index();
+  int N = nodes_.size();
+
+  if (N < 2 || i < 0 || i >= N || nodes_[i] != n)
+  {
+    measured_ = false;
+    bounded_  = false;
+    return;
+  }
+
+  Vec2r c = n->coords();
+
+  if (measured_)
+  {
+    Vec2r p = nodes_[(i+N-1)%N]->coords();
+    Vec2r q = nodes_[(i+1)%N]->coords();
+
+    add_edge(p, from, -1.0);
+    add_edge(from, q, -1.0);
+    add_edge(p, c, 1.0);
+    add_edge(c, q, 1.0);
+  }
+
+  if (bounded_)
+  {
+    if (shrinks(bb_lo_, bb_hi_, from, c))
+      bounded_ = false;
+    else
+    {
+      bb_lo_ = bbox_min(bb_lo_, c);
+      bb_hi_ = bbox_max(bb_hi_, c);
+    }
+  }
+}
+
+/***********************************************************
+* Functions return the geometric properties, which are 
+* only summed up again after modifications of many nodes
+***********************************************************/
+double Shape::area()
+{
+  if (!measured_)
+    measure();
+
+  return 0.5 * area2_;
+}
+
+double Shape::perimeter()
+{
+  if (!measured_)
+    measure();
+
+  return perimeter_;
+}
+
+/***********************************************************
+* The centroid of degenerate shapes without an area is the
+* center of their bounding box
+***********************************************************/
+Vec2r Shape::centroid()
+{
+  if (orientation() == Orient::CL)
+  {
+    Vec2r lo, hi;
+    bounding_box(lo, hi);
+    return (lo + hi) * 0.5f;
   }
+
+  Vec2d c = ref_ + moment_ / (3.0 * area2_);
+  return Vec2r { Real(c[0]), Real(c[1]) };
+}
+
+/***********************************************************
+* Areas below the rounding error of the perimeter count as
+* collinear
+***********************************************************/
+Orient Shape::orientation()
+{
+  if (!measured_)
+    measure();
+
+  if (std::fabs(area2_) <= 1.0e-12 * perimeter_ * perimeter_)
+    return Orient::CL;
+
+  return area2_ > 0.0 ? Orient::CW : Orient::CCW;
+}
+
+void Shape::bounding_box(Vec2r& lo, Vec2r& hi)
+{
+  if (!bounded_)
+  {
+    bb_lo_ = bb_hi_ = Vec2r { 0.0f, 0.0f };
+
+    for (int i = 0; i < nodes_.size(); ++i)
+    {
+      Vec2r c = nodes_[i]->coords();
+      bb_lo_ = i ? bbox_min(bb_lo_, c) : c;
+      bb_hi_ = i ? bbox_max(bb_hi_, c) : c;
+    }
+
+    bounded_ = true;
+  }
+
+  lo = bb_lo_;
+  hi = bb_hi_;
+}
+
+/***********************************************************
+* Function returns the triangulation of the shape, which
+* is only recomputed after its nodes have been modified
+***********************************************************/
+const Triangulation& Shape::triangulation()
+{
+  if (!triangulated_)
+  {
+    std::vector<Vec2r> outline;
+    outline.reserve(nodes_.size());
+    for (auto n : nodes_)
+      outline.push_back(n->coords());
+
+    triangulation_ = triangulate(outline);
+    triangulated_  = true;
+  }
+
+  return triangulation_;
+}
+
+/***********************************************************
+* Function returns the convex hull of the shape
+***********************************************************/
+const std::vector<Vec2r>& Shape::convex_hull()
+{
+  if (!hulled_)
+  {
+    hull_   = ::convex_hull(coords());
+    hulled_ = true;
+  }
+
+  return hull_;
+}
+
+/***********************************************************
+* Function returns the convex parts of the shape, which are
+* merged from the triangles of its triangulation
+***********************************************************/
+const std::vector<std::vector<Vec2r>>& Shape::convex_parts()
+{
+  if (!decomposed_)
+  {
+    convex_parts_ = convex_decomposition(triangulation());
+    decomposed_   = true;
+  }
+
+  return convex_parts_;
+}
+
+/***********************************************************
+* Function returns the nodes in fixed-point coordinates,
+* if all of them lie on the fixed-point grid
+***********************************************************/
+const std::vector<Vec2l>* Shape::fixed_nodes()
+{
+  if (!fixed_checked_)
+  {
+    fixed_.resize(nodes_.size());
+    fixed_exact_ = true;
+
+    for (int i = 0; fixed_exact_ && i < nodes_.size(); ++i)
+      fixed_exact_ = to_fixed(nodes_[i]->coords(), fixed_[i]);
+
+    fixed_checked_ = true;
+  }
+
+  return fixed_exact_ ? &fixed_ : nullptr;
+}
+
+/***********************************************************
+* Function to check if the point n lies left of all edges
+* of the closed polygon c
+***********************************************************/
+template <typename C, typename V>
+static bool left_of_edges(const C& c, const V& n)
+{
+  int N = c.size();
+  for (int i = 0; i < N; i++)
+    if (!is_left(c[i], c[(i+1)%N], n))
+      return false;
   return true;
 }
 
+/***********************************************************
+* Function to check if a node is contained inside the shape
+***********************************************************/
+bool Shape::contains_node(const Vec2r& n)
+{
+  const std::vector<Vec2l>* f = fixed_nodes();
+  Vec2l n_f;
+
+  if (f && to_fixed(n, n_f))
+    return left_of_edges(*f, n_f);
+
+  return left_of_edges(NodeCoords{nodes_}, n);
+}
+
 /***********************************************************
 * Function returns the first node located at a position p
 ***********************************************************/
-Node* Shape::get_node(const Vec2f& p)
+Node* Shape::get_node(const Vec2r& p)
 {
+  Vec2r lo, hi;
+  bounding_box(lo, hi);
+
+  // Nodes are picked within 0.1 units
+  if ( p[0] < lo[0] - 0.1f || p[0] > hi[0] + 0.1f ||
+       p[1] < lo[1] - 0.1f || p[1] > hi[1] + 0.1f )
+    return nullptr;
+
   for (auto n : nodes_)
     if ( (p-n->coords()).length_squared() < 0.01f )
       return n;
@@ -636,7 +1338,7 @@ Node* Shape::get_node(int index)
 /***********************************************************
 * Function to move the entire shape
 ***********************************************************/
-void Shape::move(const Vec2f& d)
+void Shape::move(const Vec2r& d)
 {
   for (auto n : nodes_)
     n->coords(n->coords() +d );
@@ -4,12 +4,16 @@
 #include <list>
 
 #include "Vec2.h"
+#include "Convex.h"
+#include "Offset.h"
+#include "Triangulation.h"
 #include "olc_pixel_game_engine.h"
 
 
 
 class Shape;
 class ModelSpace;
+class JobControl;
 
 
 /***********************************************************
@@ -18,8 +22,8 @@ class ModelSpace;
 struct IntersectData
 {
   // t_list / b_list: contain point coordinates
-  std::vector<Vec2f> t_list;
-  std::vector<Vec2f> b_list;
+  std::vector<Vec2r> t_list;
+  std::vector<Vec2r> b_list;
 
   // t_intersec / b_intersec: true, if point coordinate is 
   //                          an intersection
@@ -47,7 +51,8 @@ struct IntersectData
 * intersection links, which can be used to construct 
 * the union or cuttings of both polygons.
 ***********************************************************/
-IntersectData* prepare_poly_intersection(Shape* t, Shape *b);
+IntersectData* prepare_poly_intersection(Shape* t, Shape *b,
+                                         JobControl* ctl = nullptr);
 
 
 /***********************************************************
@@ -63,14 +68,15 @@ public:
 
   Node(Shape& s, int index) 
   : parent_{s}, index_{index} {}
-  Node(Shape& s, int index, const Vec2f& v) 
+  Node(Shape& s, int index, const Vec2r& v) 
   : parent_{s}, index_{index}, coords_{v} {}
   ~Node() {}
 
   Shape& parent() { return parent_;}
+  const Shape& parent() const { return parent_;}
 
-  Vec2f coords() const { return coords_;}
-  void coords(const Vec2f& v) { coords_ = v; }
+  Vec2r coords() const { return coords_;}
+  void coords(const Vec2r& v);
 
   void index(int i) { index_ = i; }
   int index() const { return index_; }
@@ -79,7 +85,11 @@ public:
   State state() { return state_; }
 
 private:
-  Vec2f     coords_;
+  // Moves the nodes in batches and invalidates their
+  // shapes once
+  friend class Selection;
+
+  Vec2r     coords_;
   Shape&    parent_;
   int       index_;
   State     state_ = State::Unvisited;
@@ -98,7 +108,11 @@ public:
   *********************************************************/
   Shape(ModelSpace& space, int index, bool extr) 
   : space_{space}, index_{index}, exteriror_{extr} {}
-  virtual ~Shape() {}
+  virtual ~Shape() 
+  { 
+    for (auto n : nodes_)
+      delete n;
+  }
 
   /*********************************************************
   * Drawing  
@@ -110,25 +124,89 @@ public:
   * Update / Check for validity
   *********************************************************/
   virtual bool valid();
-  virtual void move(const Vec2f& d);
+  bool self_intersection(int& i_edge, int& j_edge);
+  virtual void move(const Vec2r& d);
 
   /*********************************************************
   * Node handling
   *********************************************************/
-  virtual Node* add_node(const Vec2f& n);
-  virtual Node* add_node(int i, const Vec2f& n);
-  virtual Node* get_node(const Vec2f& p);
+  virtual Node* add_node(const Vec2r& n);
+  virtual Node* add_node(int i, const Vec2r& n);
+  virtual Node* get_node(const Vec2r& p);
   virtual Node* get_node(int i);
   virtual void  rem_node(int index);
+  virtual void  rem_nodes(const std::vector<bool>& removed);
+
+  // Removes duplicate nodes and nodes on a straight line 
+  // between their neighbors, returns their number
+  int normalize();
   virtual void  set_orientation(Orient orient);
-  virtual bool  contains_node(const Vec2f& n);
+  virtual bool  contains_node(const Vec2r& n);
 
   /*********************************************************
   * Interaction with other shapes
   *********************************************************/
   virtual bool contains_shape(Shape *s);
-  virtual Shape* merge(Shape* s);
-  virtual std::vector<Shape*> clip(Shape* s);
+  virtual Shape* merge(Shape* s, JobControl* ctl = nullptr);
+  virtual std::vector<Shape*> clip(Shape* s, 
+                                   JobControl* ctl = nullptr);
+
+  /*********************************************************
+  * New shapes bounding the region within the distance of
+  * this shape, or within the shape and away from its 
+  * boundary for negative distances. Holes become shapes
+  * of the other kind.
+  *********************************************************/
+  virtual std::vector<Shape*> offset(Real distance, JoinType join,
+                                     Real max_error,
+                                     JobControl* ctl = nullptr);
+
+  /*********************************************************
+  * Independent copy for processing on other threads
+  *********************************************************/
+  virtual Shape* snapshot();
+
+  /*********************************************************
+  * Triangulation of the shape, which is cached until its
+  * nodes are modified
+  *********************************************************/
+  const Triangulation& triangulation();
+  void invalidate();
+
+  /*********************************************************
+  * Convex hull and convex parts of the shape for cheap
+  * convex tests, which are cached until its nodes are 
+  * modified
+  *********************************************************/
+  const std::vector<Vec2r>& convex_hull();
+  const std::vector<std::vector<Vec2r>>& convex_parts();
+
+  /*********************************************************
+  * Geometric properties of the closed polygon, which are
+  * sums over its edges. They are cached and updated in 
+  * O(1), when single nodes are moved, inserted or removed.
+  * The signed area is negative for counter-clockwise
+  * shapes.
+  *********************************************************/
+  double area();
+  double perimeter();
+  Vec2r  centroid();
+  Orient orientation();
+  void   bounding_box(Vec2r& lo, Vec2r& hi);
+
+  /*********************************************************
+  * Fixed-point copy of the nodes for exact predicates,
+  * which is cached until the nodes are modified. Returns
+  * nullptr, if a node does not lie on the fixed-point grid.
+  *********************************************************/
+  const std::vector<Vec2l>* fixed_nodes();
+
+  // Increases with every modification of the nodes. Shapes
+  // without an index, like snapshots and the results of 
+  // jobs, are not part of the model space and count their
+  // revisions on their own, such that workers never modify
+  // the revision of the model space.
+  unsigned revision() const { return revision_; }
 
   /*********************************************************
   * Setters / Getters
@@ -138,11 +216,14 @@ public:
   void complete(bool c) { complete_ = c; }
   bool complete() const { return complete_; }
 
-  int index(int i) { index_ = i; }
+  void index(int i);
   int index() const { return index_; }
 
   int number_of_nodes() const { return nodes_.size(); }
 
+  // Coordinates of all nodes
+  std::vector<Vec2r> coords() const;
+
   bool exterior() const { return exteriror_; }
 
 protected:
@@ -154,4 +235,52 @@ protected:
   olc::Pixel        color_      = olc::GREEN; 
   bool              complete_   = false;
 
+  Triangulation     triangulation_;
+  bool              triangulated_ = false;
+
+  std::vector<Vec2r> hull_;
+  bool              hulled_       = false;
+
+  std::vector<std::vector<Vec2r>> convex_parts_;
+  bool              decomposed_   = false;
+
+  std::vector<Vec2l> fixed_;
+  bool              fixed_checked_ = false;
+  bool              fixed_exact_   = false;
+  unsigned          revision_     = 0;
+
+  // Edge sums of the geometric properties, relative to the
+  // reference point ref_ near the shape
+  double            area2_        = 0.0;
+  double            perimeter_    = 0.0;
+  Vec2d             moment_       = {0.0, 0.0};
+  Vec2d             ref_          = {0.0, 0.0};
+  bool              measured_     = false;
+
+  Vec2r             bb_lo_        = {0.0f, 0.0f};
+  Vec2r             bb_hi_        = {0.0f, 0.0f};
+  bool              bounded_      = false;
+
+private:
+  // Updates the geometric properties of moved nodes
+  friend class Node;
+
+  void outdate();
+  void measure();
+  void add_edge(const Vec2r& p, const Vec2r& q, double sign);
+  void node_inserted(int index);
+  void node_removed(int index, const Vec2r& c);
+  void node_moved(const Node* n, const Vec2r& from);
+
 };
+
+/***********************************************************
+* Moving a node invalidates the cached data of its shape,
+* except for its geometric properties, which are updated
+***********************************************************/
+inline void Node::coords(const Vec2r& v)
+{
+  Vec2r from = coords_;
+  coords_ = v;
+  parent_.node_moved(this, from);
+}
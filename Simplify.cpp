@@ -0,0 +1,312 @@
+#include "Simplify.h"
+#include "ModelSpace.h"
+#include "Polygon.h"
+#include "Shape.h"
+#include "Trace.h"
+
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+* Uniform grid of nodes, which are identified by their
+* shape and their index
+***********************************************************/
+class NodeGrid
+{
+public:
+  NodeGrid(const Vec2r& lo, const Vec2r& hi, int n_nodes)
+  : lo_{lo}
+  {
+    Vec2r d = hi - lo;
+    Real area = d[0] * d[1];
+
+    if (area > 0.0f)
+      h_ = std::sqrt(area / maximum(n_nodes, 1));
+    else
+      h_ = maximum(d[0], d[1]) / maximum(n_nodes, 1);
+
+    if (!(h_ > 0.0f))
+      h_ = 1.0f;
+  }
+
+  // Returns the id of the new entry
+  int insert(const Shape* s, int i, const Vec2r& p)
+  {
+    int e = entries_.size();
+    entries_.push_back( Entry { p, s, i, true } );
+    cells_[key(cell(p[0], 0), cell(p[1], 1))].push_back(e);
+    return e;
+  }
+
+  void remove(int e) { entries_[e].alive = false; }
+
+  // True, if another node than a, i and b of shape s lies
+  // within the closed triangle (a,i,b)
+  bool blocked(const Shape* s, int a, int i, int b,
+               const Vec2r& p_a, const Vec2r& p_i,
+               const Vec2r& p_b) const;
+
+private:
+  struct Entry
+  {
+    Vec2r         coords;
+    const Shape*  shape;
+    int           index;
+    bool          alive;
+  };
+
+  Vec2r lo_;
+  Real  h_;
+
+  std::vector<Entry>                             entries_;
+  std::unordered_map<int64_t, std::vector<int>>  cells_;
+
+  int64_t cell(Real x, int dim) const
+  { return int64_t(std::floor((x - lo_[dim]) / h_)); }
+
+  static int64_t key(int64_t i, int64_t j)
+  { return (i << 32) ^ (j & 0xffffffff); }
+};
+
+/***********************************************************
+* Function to check the triangle of a removed node for
+* other nodes. If the triangle is degenerate, only the new
+* edge is checked.
+***********************************************************/
+bool NodeGrid::blocked(const Shape* s, int a, int i, int b,
+                       const Vec2r& p_a, const Vec2r& p_i,
+                       const Vec2r& p_b) const
+{
+  Orient o = orientation(p_a, p_i, p_b);
+  Orient outside = (o == Orient::CW) ? Orient::CCW : Orient::CW;
+
+  Vec2r lo = bbox_min(bbox_min(p_a, p_i), p_b);
+  Vec2r hi = bbox_max(bbox_max(p_a, p_i), p_b);
+
+  for (int64_t x = cell(lo[0], 0); x <= cell(hi[0], 0); ++x)
+    for (int64_t y = cell(lo[1], 1); y <= cell(hi[1], 1); ++y)
+    {
+      auto it = cells_.find( key(x, y) );
+      if (it == cells_.end())
+        continue;
+
+      for (int e : it->second)
+      {
+        const Entry& n = entries_[e];
+
+        if ( !n.alive || ( n.shape == s &&
+             (n.index == a || n.index == i || n.index == b) ) )
+          continue;
+
+        const Vec2r& p = n.coords;
+
+        if ( p[0] < lo[0] || p[0] > hi[0] ||
+             p[1] < lo[1] || p[1] > hi[1] )
+          continue;
+
+        if (o == Orient::CL)
+        {
+          if (orientation(p_a, p_b, p) == Orient::CL)
+            return true;
+          continue;
+        }
+
+        if ( orientation(p_a, p_i, p) != outside &&
+             orientation(p_i, p_b, p) != outside &&
+             orientation(p_b, p_a, p) != outside )
+          return true;
+      }
+    }
+
+  return false;
+}
+
+/***********************************************************
+* Distance of p to the line through a and b
+***********************************************************/
+static Real deviation(const Vec2r& a, const Vec2r& p, const Vec2r& b)
+{
+  Vec2r d = b - a;
+  Real l2 = dot(d, d);
+
+  if (l2 < geometry_small)
+    return (p - a).length();
+
+  return std::fabs(cross(d, p - a)) / std::sqrt(l2);
+}
+
+/***********************************************************
+* Shapes, which can be simplified
+***********************************************************/
+static bool simplifiable(Shape* s)
+{
+  Parametric* p = dynamic_cast<Parametric*>(s);
+
+  return s->complete() && s->number_of_nodes() > 3
+      && !(p && p->parametric());
+}
+
+/***********************************************************
+* Function to simplify a single shape, whose nodes have
+* been inserted into the grid with the given entry ids
+***********************************************************/
+static int simplify(Shape* s, Real tolerance, NodeGrid& grid,
+                    const std::vector<int>& entry)
+{
+  TRACE_ZONE("simplify");
+
+  std::vector<Vec2r> c = s->coords();
+  int N = c.size();
+
+  std::vector<int>      prev(N), next(N);
+  std::vector<unsigned> version(N, 0);
+  std::vector<bool>     removed(N, false);
+
+  for (int i = 0; i < N; ++i)
+  {
+    prev[i] = (i + N - 1) % N;
+    next[i] = (i + 1) % N;
+  }
+
+  struct Candidate
+  {
+    Real      key;
+    int       index;
+    unsigned  version;
+
+    bool operator<(const Candidate& o) const { return key > o.key; }
+  };
+
+  std::priority_queue<Candidate> queue;
+
+  auto push = [&](int i)
+  {
+    Real d = deviation(c[prev[i]], c[i], c[next[i]]);
+    if (d <= tolerance)
+      queue.push( Candidate { d, i, version[i] } );
+  };
+
+  for (int i = 0; i < N; ++i)
+    push(i);
+
+  int n = N;
+
+  while (!queue.empty() && n > 3)
+  {
+    Candidate k = queue.top();
+    queue.pop();
+
+    int i = k.index;
+    if (removed[i] || k.version != version[i])
+      continue;
+
+    int a = prev[i];
+    int b = next[i];
+
+    // The last three nodes must span a triangle
+    if (n == 4 && orientation(c[a], c[b], c[next[b]]) == Orient::CL)
+      continue;
+
+    // The node is checked again, once a neighbor changes
+    if (grid.blocked(s, a, i, b, c[a], c[i], c[b]))
+      continue;
+
+    removed[i] = true;
+    grid.remove(entry[i]);
+    next[a] = b;
+    prev[b] = a;
+    --n;
+
+    ++version[a];
+    ++version[b];
+    push(a);
+    push(b);
+  }
+
+  if (n == N)
+    return 0;
+
+  s->rem_nodes(removed);
+
+  return N - n;
+}
+
+/***********************************************************
+* Function to simplify a single shape. Only nodes within
+* its bounding box can interfere.
+***********************************************************/
+int simplify_shape(ModelSpace& space, Shape* s, Real tolerance)
+{
+  if (!simplifiable(s))
+    return 0;
+
+  Vec2r lo, hi;
+  s->bounding_box(lo, hi);
+
+  NodeGrid grid(lo, hi, s->number_of_nodes());
+  std::vector<int> entry(s->number_of_nodes());
+
+  for (auto shapes : {&space.extr_shapes(), &space.intr_shapes()})
+    for (auto t : *shapes)
+      for (int i = 0; i < t->number_of_nodes(); ++i)
+      {
+        Vec2r p = t->get_node(i)->coords();
+
+        if (t == s)
+          entry[i] = grid.insert(s, i, p);
+        else if ( p[0] >= lo[0] && p[0] <= hi[0] &&
+                  p[1] >= lo[1] && p[1] <= hi[1] )
+          grid.insert(t, i, p);
+      }
+
+  return simplify(s, tolerance, grid, entry);
+}
+
+/***********************************************************
+* Function to simplify all shapes of a model space, which
+* share a single grid
+***********************************************************/
+int simplify_model(ModelSpace& space, Real tolerance)
+{
+  TRACE_ZONE("simplify_model");
+
+  Vec2r lo, hi;
+  int n_nodes = 0;
+
+  for (auto shapes : {&space.extr_shapes(), &space.intr_shapes()})
+    for (auto s : *shapes)
+      for (int i = 0; i < s->number_of_nodes(); ++i)
+      {
+        Vec2r p = s->get_node(i)->coords();
+        lo = n_nodes ? bbox_min(lo, p) : p;
+        hi = n_nodes ? bbox_max(hi, p) : p;
+        ++n_nodes;
+      }
+
+  if (n_nodes == 0)
+    return 0;
+
+  NodeGrid grid(lo, hi, n_nodes);
+  std::unordered_map<Shape*, std::vector<int>> entries;
+
+  for (auto shapes : {&space.extr_shapes(), &space.intr_shapes()})
+    for (auto s : *shapes)
+    {
+      std::vector<int>& entry = entries[s];
+      entry.resize(s->number_of_nodes());
+
+      for (int i = 0; i < s->number_of_nodes(); ++i)
+        entry[i] = grid.insert(s, i, s->get_node(i)->coords());
+    }
+
+  int n_removed = 0;
+
+  for (auto shapes : {&space.extr_shapes(), &space.intr_shapes()})
+    for (auto s : *shapes)
+      if (simplifiable(s))
+        n_removed += simplify(s, tolerance, grid, entries[s]);
+
+  return n_removed;
+}
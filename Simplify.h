@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Vec2.h"
+
+class Shape;
+class ModelSpace;
+
+/***********************************************************
+* Simplification of shape outlines.
+*
+* Nodes are removed in the order of their distance to the
+* edge between their neighbors, as long as this distance
+* is below the tolerance (Visvalingam-Whyatt with the
+* distance as measure). The candidates are kept in a
+* priority queue, whose entries are renewed for the
+* neighbors of every removed node, which takes
+* O(n log n) in total.
+*
+* A node is only removed, if no other node lies within the
+* triangle of the node and its neighbors. Edges can thus
+* not cross the new edge, such that neither the shape nor
+* its neighbors are invalidated. The nodes of all shapes
+* are kept in a uniform grid for these checks.
+*
+* Shapes keep at least three nodes and their orientation.
+* Primitives, which are still given by their parameters,
+* are skipped. Returns the number of removed nodes.
+***********************************************************/
+int simplify_shape(ModelSpace& space, Shape* s, Real tolerance);
+int simplify_model(ModelSpace& space, Real tolerance);
@@ -0,0 +1,636 @@
+#include "SizeField.h"
+#include "ModelSpace.h"
+#include "Shape.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+/***********************************************************
+* Quadtree parameters
+***********************************************************/
+static constexpr int   cell_capacity  = 8;
+static constexpr Real min_cell_width = 1.0e-4f;
+static constexpr int   max_stack      = 256;
+static constexpr Real max_stretch    = 8.0f;
+
+/***********************************************************
+* Distance functions
+***********************************************************/
+static Real point_segment_distance(const Vec2r& p, const Vec2r& a,
+                                    const Vec2r& b)
+{
+  Vec2r ab = b - a;
+  Real l2 = ab.length_squared();
+  Real t  = l2 > 0.0f ? dot(p-a, ab) / l2 : 0.0f;
+  t = maximum(Real(0), minimum(Real(1), t));
+  return Real((p - (a + ab * t)).length());
+}
+
+static Real box_distance(const Vec2r& p, const Vec2r& lo,
+                          const Vec2r& hi)
+{
+  Real dx = maximum(Real(0), maximum(lo[0] - p[0], p[0] - hi[0]));
+  Real dy = maximum(Real(0), maximum(lo[1] - p[1], p[1] - hi[1]));
+  return std::sqrt(dx*dx + dy*dy);
+}
+
+static Real box_box_distance(const Vec2r& a_lo, const Vec2r& a_hi,
+                              const Vec2r& b_lo, const Vec2r& b_hi)
+{
+  Real dx = maximum(Real(0), maximum(a_lo[0] - b_hi[0], b_lo[0] - a_hi[0]));
+  Real dy = maximum(Real(0), maximum(a_lo[1] - b_hi[1], b_lo[1] - a_hi[1]));
+  return std::sqrt(dx*dx + dy*dy);
+}
+
+/***********************************************************
+* True, if segment (a,b) overlaps the box (lo, hi), which
+* is the case if the boxes overlap and the corners of the
+* box do not all lie on the same side of the segment
+***********************************************************/
+static bool segment_in_box(const Vec2r& a, const Vec2r& b,
+                           const Vec2r& lo, const Vec2r& hi)
+{
+  if ( minimum(a[0], b[0]) > hi[0] || maximum(a[0], b[0]) < lo[0] ||
+       minimum(a[1], b[1]) > hi[1] || maximum(a[1], b[1]) < lo[1] )
+    return false;
+
+  Vec2r ab = b - a;
+  Real s0 = cross(ab, Vec2r { lo[0], lo[1] } - a);
+  Real s1 = cross(ab, Vec2r { hi[0], lo[1] } - a);
+  Real s2 = cross(ab, Vec2r { hi[0], hi[1] } - a);
+  Real s3 = cross(ab, Vec2r { lo[0], hi[1] } - a);
+
+  return !( (s0 > 0.0f && s1 > 0.0f && s2 > 0.0f && s3 > 0.0f) ||
+            (s0 < 0.0f && s1 < 0.0f && s2 < 0.0f && s3 < 0.0f) );
+}
+
+/***********************************************************
+* Function to remove all edges and cells
+***********************************************************/
+void SizeField::clear()
+{
+  edges_.clear();
+  free_edges_.clear();
+  cells_.clear();
+  shapes_.clear();
+  root_    = -1;
+  n_edges_ = 0;
+}
+
+/***********************************************************
+* Function to add a new leaf cell
+***********************************************************/
+int SizeField::add_cell(const Vec2r& lo, const Vec2r& hi, int parent)
+{
+  Cell c;
+  c.lo       = lo;
+  c.hi       = hi;
+  c.parent   = parent;
+  c.min_size = max_size_;
+  cells_.push_back(c);
+  return cells_.size() - 1;
+}
+
+/***********************************************************
+* Function to enlarge the root cell until it contains the
+* box (lo, hi). The old root becomes a child of the new one.
+***********************************************************/
+void SizeField::grow(const Vec2r& lo, const Vec2r& hi)
+{
+  if (root_ < 0)
+  {
+    Vec2r m = (lo + hi) * 0.5f;
+    Real w = maximum(Real(1), maximum(hi[0]-lo[0], hi[1]-lo[1]));
+    root_ = add_cell(m - w, m + w, -1);
+    return;
+  }
+
+  while ( lo[0] < cells_[root_].lo[0] || lo[1] < cells_[root_].lo[1] ||
+          hi[0] > cells_[root_].hi[0] || hi[1] > cells_[root_].hi[1] )
+  {
+    Vec2r r_lo = cells_[root_].lo;
+    Vec2r r_hi = cells_[root_].hi;
+    Real w = r_hi[0] - r_lo[0];
+
+    // Extend towards the box
+    int k = 0;
+    Vec2r n_lo = r_lo;
+    if (lo[0] < r_lo[0]) { n_lo[0] -= w; k += 1; }
+    if (lo[1] < r_lo[1]) { n_lo[1] -= w; k += 2; }
+
+    int n = add_cell(n_lo, n_lo + 2.0f * w, -1);
+    int first = cells_.size();
+
+    for (int i = 0; i < 4; ++i)
+    {
+      Vec2r c_lo = n_lo + Vec2r { (i & 1) ? w : 0.0f, (i & 2) ? w : 0.0f };
+      add_cell(c_lo, c_lo + w, n);
+    }
+
+    // Move the old root into its slot below the new root
+    Cell& old = cells_[first + k];
+    old = cells_[root_];
+    old.parent = n;
+    if (old.child >= 0)
+      for (int i = 0; i < 4; ++i)
+        cells_[old.child + i].parent = first + k;
+
+    cells_[root_].edges.clear();
+    cells_[root_].child = -1;
+
+    cells_[n].child = first;
+    root_ = n;
+
+    cells_[first + k].dirty = false;
+    mark_dirty(first + k);
+  }
+}
+
+/***********************************************************
+* True, if edge e is kept in cell c instead of being passed
+* on to its children. Long edges stay in larger cells, such
+* that every edge is stored in a few cells only.
+***********************************************************/
+bool SizeField::keeps(int c, int e) const
+{
+  const Cell& C = cells_[c];
+  return C.child < 0 ||
+         edges_[e].length > max_stretch * 0.5f * (C.hi[0] - C.lo[0]);
+}
+
+/***********************************************************
+* Function to split a leaf into four children
+***********************************************************/
+void SizeField::split(int c)
+{
+  Vec2r lo = cells_[c].lo;
+  Vec2r w  = (cells_[c].hi - lo) * 0.5f;
+  int first = cells_.size();
+
+  for (int i = 0; i < 4; ++i)
+  {
+    Vec2r c_lo = lo + Vec2r { (i & 1) ? w[0] : 0.0f, (i & 2) ? w[1] : 0.0f };
+    add_cell(c_lo, c_lo + w, c);
+  }
+
+  std::vector<int> edges;
+  edges.swap(cells_[c].edges);
+  cells_[c].child = first;
+
+  for (int e : edges)
+  {
+    if (keeps(c, e))
+    {
+      cells_[c].edges.push_back(e);
+      continue;
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+      Cell& child = cells_[first + i];
+      if (segment_in_box(edges_[e].a, edges_[e].b, child.lo, child.hi))
+        child.edges.push_back(e);
+    }
+  }
+
+  for (int i = 0; i < 4; ++i)
+    cells_[first + i].dirty = true;
+
+  cells_[c].dirty = false;
+  mark_dirty(c);
+
+  for (int i = 0; i < 4; ++i)
+    if ( cells_[first + i].edges.size() > cell_capacity &&
+         w[0] > min_cell_width )
+      split(first + i);
+}
+
+/***********************************************************
+* Function to insert edge e below cell c
+***********************************************************/
+void SizeField::insert(int c, int e)
+{
+  const Edge& E = edges_[e];
+
+  if (!segment_in_box(E.a, E.b, cells_[c].lo, cells_[c].hi))
+    return;
+
+  if (!keeps(c, e))
+  {
+    for (int i = 0; i < 4; ++i)
+      insert(cells_[c].child + i, e);
+    return;
+  }
+
+  cells_[c].edges.push_back(e);
+  mark_dirty(c);
+
+  if ( cells_[c].child < 0 &&
+       cells_[c].edges.size() > cell_capacity &&
+       cells_[c].hi[0] - cells_[c].lo[0] > 2.0f * min_cell_width )
+    split(c);
+}
+
+/***********************************************************
+* Function to collect all cells below c, that store edge e
+***********************************************************/
+void SizeField::cells_of(int c, int e, std::vector<int>& found) const
+{
+  const Edge& E = edges_[e];
+
+  if (!segment_in_box(E.a, E.b, cells_[c].lo, cells_[c].hi))
+    return;
+
+  if (keeps(c, e))
+  {
+    found.push_back(c);
+    return;
+  }
+
+  for (int i = 0; i < 4; ++i)
+    cells_of(cells_[c].child + i, e, found);
+}
+
+/***********************************************************
+* Function to mark a cell and its parents as outdated
+***********************************************************/
+void SizeField::mark_dirty(int c)
+{
+  while (c >= 0 && !cells_[c].dirty)
+  {
+    cells_[c].dirty = true;
+    c = cells_[c].parent;
+  }
+}
+
+/***********************************************************
+* Function to recompute the smallest feature size and the
+* longest edge of all outdated cells
+***********************************************************/
+void SizeField::refresh(int c)
+{
+  if (!cells_[c].dirty)
+    return;
+
+  Real min_size = max_size_;
+  Real max_len  = 0.0f;
+
+  for (int e : cells_[c].edges)
+  {
+    min_size = minimum(min_size, edges_[e].size);
+    max_len  = maximum(max_len, edges_[e].length);
+  }
+
+  if (cells_[c].child >= 0)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      const Cell& child = cells_[cells_[c].child + i];
+      refresh(cells_[c].child + i);
+      min_size = minimum(min_size, child.min_size);
+      max_len  = maximum(max_len, child.max_len);
+    }
+  }
+
+  cells_[c].min_size = min_size;
+  cells_[c].max_len  = max_len;
+  cells_[c].dirty    = false;
+}
+
+/***********************************************************
+* Function to add the edge from node i to node i+1 of a
+* shape into the quadtree
+***********************************************************/
+int SizeField::add_edge(Shape* s, int i)
+{
+  int N = s->number_of_nodes();
+
+  Edge E;
+  E.shape   = s;
+  E.index   = i;
+  E.n_nodes = N;
+  E.a       = s->get_node(i)->coords();
+  E.b       = s->get_node((i+1) % N)->coords();
+  E.length  = Real((E.b - E.a).length());
+  E.size    = minimum(max_size_, E.length);
+  E.alive   = true;
+
+  int e;
+  if (free_edges_.empty())
+  {
+    e = edges_.size();
+    edges_.push_back(E);
+  }
+  else
+  {
+    e = free_edges_.back();
+    free_edges_.pop_back();
+    edges_[e] = E;
+  }
+  n_edges_++;
+
+  grow(bbox_min(E.a, E.b), bbox_max(E.a, E.b));
+  insert(root_, e);
+
+  return e;
+}
+
+/***********************************************************
+* Function to remove all edges of a shape from the quadtree
+* The bounding box of the removed edges is added to lo, hi
+***********************************************************/
+void SizeField::remove_edges(Shape* s, Vec2r& lo, Vec2r& hi,
+                             bool& found)
+{
+  auto it = shapes_.find(s);
+  if (it == shapes_.end())
+    return;
+
+  std::vector<int> cells;
+
+  for (int e : it->second.edges)
+  {
+    Edge& E = edges_[e];
+    Vec2r e_lo = bbox_min(E.a, E.b);
+    Vec2r e_hi = bbox_max(E.a, E.b);
+
+    lo = found ? bbox_min(lo, e_lo) : e_lo;
+    hi = found ? bbox_max(hi, e_hi) : e_hi;
+    found = true;
+
+    cells.clear();
+    cells_of(root_, e, cells);
+
+    for (int c : cells)
+    {
+      std::vector<int>& ce = cells_[c].edges;
+      ce.erase( std::remove(ce.begin(), ce.end(), e), ce.end() );
+      mark_dirty(c);
+    }
+
+    E.alive = false;
+    E.shape = nullptr;
+    free_edges_.push_back(e);
+    n_edges_--;
+  }
+
+  it->second.edges.clear();
+}
+
+/***********************************************************
+* Function to recompute the feature sizes of all edges,
+* that may be affected by changes within the box (lo, hi).
+* These are the edges, that are closer to the box than
+* their own length.
+***********************************************************/
+void SizeField::update_sizes(const Vec2r& lo, const Vec2r& hi)
+{
+  refresh(root_);
+
+  std::vector<int> stack { root_ };
+  std::unordered_set<int> affected;
+
+  while (!stack.empty())
+  {
+    const Cell& C = cells_[stack.back()];
+    stack.pop_back();
+
+    if (box_box_distance(C.lo, C.hi, lo, hi) > minimum(max_size_, C.max_len))
+      continue;
+
+    for (int e : C.edges)
+    {
+      const Edge& E = edges_[e];
+      if (box_box_distance(bbox_min(E.a, E.b), bbox_max(E.a, E.b),
+                           lo, hi) <= minimum(max_size_, E.length))
+        affected.insert(e);
+    }
+
+    if (C.child >= 0)
+      for (int i = 0; i < 4; ++i)
+        stack.push_back(C.child + i);
+  }
+
+  std::vector<int> cells;
+
+  for (int e : affected)
+  {
+    Real size = feature_size(e);
+    if (size == edges_[e].size)
+      continue;
+
+    edges_[e].size = size;
+
+    cells.clear();
+    cells_of(root_, e, cells);
+    for (int c : cells)
+      mark_dirty(c);
+  }
+
+  refresh(root_);
+}
+
+/***********************************************************
+* Function returns the distance of point p to the closest
+* edge, that is not adjacent to edge e, or best if there
+* is no edge closer than best
+***********************************************************/
+Real SizeField::nearest(const Vec2r& p, int e, Real best) const
+{
+  const Edge& E = edges_[e];
+
+  int stack[max_stack];
+  int n = 0;
+  stack[n++] = root_;
+
+  while (n > 0)
+  {
+    const Cell& C = cells_[stack[--n]];
+
+    if (box_distance(p, C.lo, C.hi) >= best)
+      continue;
+
+    for (int f : C.edges)
+    {
+      const Edge& F = edges_[f];
+
+      if (f == e)
+        continue;
+
+      if ( F.shape == E.shape &&
+           ( F.index == (E.index + 1) % E.n_nodes ||
+             E.index == (F.index + 1) % F.n_nodes ) )
+        continue;
+
+      best = minimum(best, point_segment_distance(p, F.a, F.b));
+    }
+
+    if (C.child < 0)
+      continue;
+
+    // Visit the closest child first
+    Real d[4];
+    int   order[4] = {0, 1, 2, 3};
+    for (int i = 0; i < 4; ++i)
+      d[i] = box_distance(p, cells_[C.child+i].lo, cells_[C.child+i].hi);
+    std::sort(order, order+4, [&](int a, int b) { return d[a] > d[b]; });
+
+    for (int i = 0; i < 4 && n < max_stack; ++i)
+      stack[n++] = C.child + order[i];
+  }
+
+  return best;
+}
+
+/***********************************************************
+* Function to compute the feature size of an edge, which is
+* the minimum of its length and of its distance to all
+* non-adjacent edges.
+* The distance of two segments, that do not intersect, is
+* attained at one of their end points. A vertex close to
+* the interior of e is therefore found by the edges of
+* that vertex, which suffices for the sizing field.
+***********************************************************/
+Real SizeField::feature_size(int e) const
+{
+  const Edge& E = edges_[e];
+  Real best = minimum(max_size_, E.length);
+
+  best = nearest(E.a, e, best);
+  best = nearest(E.b, e, best);
+
+  return best;
+}
+
+/***********************************************************
+* Function to replace the edges of a shape
+***********************************************************/
+void SizeField::update(Shape* s)
+{
+  Vec2r lo, hi;
+  bool  found = false;
+
+  remove_edges(s, lo, hi, found);
+
+  ShapeEntry& entry = shapes_[s];
+  entry.revision = s->revision();
+
+  int N = s->number_of_nodes();
+
+  if (s->complete() && N >= 3)
+  {
+    for (int i = 0; i < N; ++i)
+    {
+      int e = add_edge(s, i);
+      entry.edges.push_back(e);
+
+      Vec2r e_lo = bbox_min(edges_[e].a, edges_[e].b);
+      Vec2r e_hi = bbox_max(edges_[e].a, edges_[e].b);
+      lo = found ? bbox_min(lo, e_lo) : e_lo;
+      hi = found ? bbox_max(hi, e_hi) : e_hi;
+      found = true;
+    }
+  }
+
+  if (found)
+    update_sizes(lo, hi);
+}
+
+/***********************************************************
+* Function to remove a shape from the sizing field
+***********************************************************/
+void SizeField::remove(Shape* s)
+{
+  Vec2r lo, hi;
+  bool  found = false;
+
+  remove_edges(s, lo, hi, found);
+  shapes_.erase(s);
+
+  if (found)
+    update_sizes(lo, hi);
+}
+
+/***********************************************************
+* Function to build the sizing field of all shapes
+***********************************************************/
+void SizeField::build(ModelSpace& space)
+{
+  clear();
+  sync(space);
+}
+
+/***********************************************************
+* Function to update all modified, new and removed shapes
+***********************************************************/
+void SizeField::sync(ModelSpace& space)
+{
+  TRACE_ZONE("SizeField::sync");
+
+  std::unordered_set<Shape*> present;
+
+  for (auto shapes : {&space.extr_shapes(), &space.intr_shapes()})
+    for (auto s : *shapes)
+    {
+      present.insert(s);
+
+      auto it = shapes_.find(s);
+      if (it == shapes_.end() || it->second.revision != s->revision())
+        update(s);
+    }
+
+  std::vector<Shape*> removed;
+  for (auto& entry : shapes_)
+    if (present.count(entry.first) == 0)
+      removed.push_back(entry.first);
+
+  for (auto s : removed)
+    remove(s);
+}
+
+/***********************************************************
+* Function returns the size at point p
+***********************************************************/
+Real SizeField::size(const Vec2r& p) const
+{
+  Real best = max_size_;
+
+  if (root_ < 0)
+    return best;
+
+  int stack[max_stack];
+  int n = 0;
+  stack[n++] = root_;
+
+  while (n > 0)
+  {
+    const Cell& C = cells_[stack[--n]];
+
+    if (C.min_size + grading_ * box_distance(p, C.lo, C.hi) >= best)
+      continue;
+
+    for (int e : C.edges)
+    {
+      const Edge& E = edges_[e];
+      best = minimum(best, E.size + grading_
+                     * point_segment_distance(p, E.a, E.b));
+    }
+
+    if (C.child < 0)
+      continue;
+
+    // Visit the closest child first
+    Real d[4];
+    int   order[4] = {0, 1, 2, 3};
+    for (int i = 0; i < 4; ++i)
+      d[i] = box_distance(p, cells_[C.child+i].lo, cells_[C.child+i].hi);
+    std::sort(order, order+4, [&](int a, int b) { return d[a] > d[b]; });
+
+    for (int i = 0; i < 4 && n < max_stack; ++i)
+      stack[n++] = C.child + order[i];
+  }
+
+  return best;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "Vec2.h"
+
+class Shape;
+class ModelSpace;
+
+/***********************************************************
+* Sizing field of the shape boundaries.
+*
+* Every boundary edge e defines a local feature size s_e,
+* which is the minimum of its length and of its distance to
+* the closest non-adjacent edge (narrow gaps and thin parts).
+* The size at a point p is graded away from these features:
+*
+*   h(p) = min_e ( s_e + grading * dist(p, e) )
+*
+* The edges are stored in a quadtree, whose cells know the
+* smallest feature size and the longest edge below them.
+* Long edges are kept in inner cells of about their size,
+* such that every edge is stored in a few cells only.
+* Queries prune all cells, that can not lower the size any
+* further, which takes O(log n) for evenly spread edges.
+* Changes of single shapes only update the edges close to
+* them.
+***********************************************************/
+class SizeField
+{
+public:
+  SizeField(Real grading = 0.25f, Real max_size = 1.0e6f)
+  : grading_{grading}, max_size_{max_size} {}
+  ~SizeField() {}
+
+  /*********************************************************
+  * Updates
+  *********************************************************/
+  void build(ModelSpace& space);
+
+  // Update all shapes, that have been modified, added or
+  // removed since the last call
+  void sync(ModelSpace& space);
+
+  void update(Shape* s);
+  void remove(Shape* s);
+  void clear();
+
+  /*********************************************************
+  * Queries
+  *********************************************************/
+  Real size(const Vec2r& p) const;
+
+  Real grading() const { return grading_; }
+  Real max_size() const { return max_size_; }
+  int number_of_edges() const { return n_edges_; }
+
+private:
+  struct Edge
+  {
+    Shape*  shape;
+    int     index;
+    int     n_nodes;
+    Vec2r   a;
+    Vec2r   b;
+    Real   length;
+    Real   size;
+    bool    alive;
+  };
+
+  struct Cell
+  {
+    Vec2r             lo;
+    Vec2r             hi;
+    int               child    = -1;   // First of four children
+    int               parent   = -1;
+    bool              dirty    = false;
+    Real             min_size = 0.0f;
+    Real             max_len  = 0.0f;
+    std::vector<int>  edges;
+  };
+
+  struct ShapeEntry
+  {
+    unsigned          revision;
+    std::vector<int>  edges;
+  };
+
+  Real   grading_;
+  Real   max_size_;
+  int     n_edges_ = 0;
+
+  std::vector<Edge>   edges_;
+  std::vector<int>    free_edges_;
+  std::vector<Cell>   cells_;
+  int                 root_ = -1;
+
+  std::unordered_map<Shape*, ShapeEntry> shapes_;
+
+  int  add_cell(const Vec2r& lo, const Vec2r& hi, int parent);
+  void grow(const Vec2r& lo, const Vec2r& hi);
+  bool keeps(int c, int e) const;
+  void split(int c);
+  void insert(int c, int e);
+  void cells_of(int c, int e, std::vector<int>& found) const;
+  void mark_dirty(int c);
+  void refresh(int c);
+
+  int   add_edge(Shape* s, int i);
+  void  remove_edges(Shape* s, Vec2r& lo, Vec2r& hi, bool& found);
+  void  update_sizes(const Vec2r& lo, const Vec2r& hi);
+  Real nearest(const Vec2r& p, int e, Real best) const;
+  Real feature_size(int e) const;
+};
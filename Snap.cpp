@@ -0,0 +1,458 @@
+#include "Snap.h"
+#include "ModelSpace.h"
+#include "Shape.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+/***********************************************************
+* Quadtree and query parameters
+***********************************************************/
+static constexpr Real min_cell_width = 1.0e-4f;
+static constexpr int   max_near       = 64;
+
+/***********************************************************
+* Function returns the closest point on segment (a,b)
+***********************************************************/
+static Vec2r closest_point(const Vec2r& p, const Vec2r& a,
+                           const Vec2r& b)
+{
+  Vec2r ab = b - a;
+  Real l2 = ab.length_squared();
+  Real t  = l2 > 0.0f ? dot(p-a, ab) / l2 : 0.0f;
+  t = maximum(Real(0), minimum(Real(1), t));
+  return a + ab * t;
+}
+
+static bool boxes_overlap(const Vec2r& a_lo, const Vec2r& a_hi,
+                          const Vec2r& b_lo, const Vec2r& b_hi)
+{
+  return a_lo[0] <= b_hi[0] && b_lo[0] <= a_hi[0] &&
+         a_lo[1] <= b_hi[1] && b_lo[1] <= a_hi[1];
+}
+
+/***********************************************************
+* Function to create a new cell
+***********************************************************/
+int SnapIndex::add_cell(const Vec2r& lo, const Vec2r& hi)
+{
+  Cell c;
+  c.lo = lo;
+  c.hi = hi;
+  cells_.push_back(c);
+  return cells_.size() - 1;
+}
+
+/***********************************************************
+* Function to enlarge the root cell, until its box contains
+* the point p and its width is at least w
+***********************************************************/
+void SnapIndex::grow(const Vec2r& p, Real w_min)
+{
+  if (root_ < 0)
+  {
+    Real w = maximum(Real(1), w_min);
+    root_ = add_cell(p - 0.5f * w, p + 0.5f * w);
+    return;
+  }
+
+  while ( p[0] < cells_[root_].lo[0] || p[1] < cells_[root_].lo[1] ||
+          p[0] > cells_[root_].hi[0] || p[1] > cells_[root_].hi[1] ||
+          cells_[root_].hi[0] - cells_[root_].lo[0] < w_min )
+  {
+    Vec2r r_lo = cells_[root_].lo;
+    Vec2r r_hi = cells_[root_].hi;
+    Real w = r_hi[0] - r_lo[0];
+
+    // Extend towards the point
+    int k = 0;
+    Vec2r n_lo = r_lo;
+    if (p[0] < r_lo[0]) { n_lo[0] -= w; k += 1; }
+    if (p[1] < r_lo[1]) { n_lo[1] -= w; k += 2; }
+
+    int n = add_cell(n_lo, n_lo + 2.0f * w);
+    int first = cells_.size();
+
+    for (int i = 0; i < 4; ++i)
+    {
+      Vec2r c_lo = n_lo + Vec2r { (i & 1) ? w : 0.0f, (i & 2) ? w : 0.0f };
+      add_cell(c_lo, c_lo + w);
+    }
+    cells_[n].child = first;
+
+    // Move the old root into its slot below the new root
+    Cell& old = cells_[first + k];
+    old = std::move(cells_[root_]);
+    for (int e : old.edges)
+      edges_[e].cell = first + k;
+
+    cells_[root_].edges.clear();
+    cells_[root_].child = -1;
+    root_ = n;
+  }
+}
+
+/***********************************************************
+* Function to store an edge in the smallest cell, that
+* contains its bounding box within its loose bounds
+***********************************************************/
+void SnapIndex::insert(int e)
+{
+  Vec2r lo = bbox_min(edges_[e].a, edges_[e].b);
+  Vec2r hi = bbox_max(edges_[e].a, edges_[e].b);
+  Vec2r m  = (lo + hi) * 0.5f;
+  Real extent = maximum(hi[0] - lo[0], hi[1] - lo[1]);
+
+  grow(m, extent);
+
+  int c = root_;
+
+  while (true)
+  {
+    Real w = cells_[c].hi[0] - cells_[c].lo[0];
+
+    if (0.5f * w < extent || 0.5f * w < min_cell_width)
+      break;
+
+    if (cells_[c].child < 0)
+    {
+      Vec2r c_lo  = cells_[c].lo;
+      int   first = cells_.size();
+
+      for (int i = 0; i < 4; ++i)
+      {
+        Vec2r q_lo = c_lo + Vec2r { (i & 1) ? 0.5f * w : 0.0f,
+                                    (i & 2) ? 0.5f * w : 0.0f };
+        add_cell(q_lo, q_lo + 0.5f * w);
+      }
+      cells_[c].child = first;
+    }
+
+    Vec2r mid = (cells_[c].lo + cells_[c].hi) * 0.5f;
+    int   q   = (m[0] >= mid[0] ? 1 : 0) + (m[1] >= mid[1] ? 2 : 0);
+    c = cells_[c].child + q;
+  }
+
+  edges_[e].cell = c;
+  edges_[e].slot = cells_[c].edges.size();
+  cells_[c].edges.push_back(e);
+}
+
+/***********************************************************
+* Function to add the edge from node i to its successor
+***********************************************************/
+int SnapIndex::add_edge(Shape* s, int i)
+{
+  int e;
+  if (!free_edges_.empty())
+  {
+    e = free_edges_.back();
+    free_edges_.pop_back();
+  }
+  else
+  {
+    e = edges_.size();
+    edges_.emplace_back();
+  }
+
+  int N = s->number_of_nodes();
+
+  Edge& E   = edges_[e];
+  E.shape   = s;
+  E.index   = i;
+  E.n_nodes = N;
+  E.a       = s->get_node(i)->coords();
+  E.b       = s->get_node((i + 1) % N)->coords();
+  E.alive   = true;
+
+  insert(e);
+  ++n_edges_;
+
+  return e;
+}
+
+/***********************************************************
+* Function to take an edge out of its cell
+***********************************************************/
+void SnapIndex::unlink(int e)
+{
+  Cell& C = cells_[edges_[e].cell];
+  int last = C.edges.back();
+  C.edges[edges_[e].slot] = last;
+  edges_[last].slot = edges_[e].slot;
+  C.edges.pop_back();
+}
+
+/***********************************************************
+* Function to remove all edges of a shape
+***********************************************************/
+void SnapIndex::remove_edges(Shape* s)
+{
+  auto it = shapes_.find(s);
+  if (it == shapes_.end())
+    return;
+
+  for (int e : it->second.edges)
+  {
+    unlink(e);
+    edges_[e].alive = false;
+    free_edges_.push_back(e);
+    --n_edges_;
+  }
+
+  it->second.edges.clear();
+}
+
+/***********************************************************
+* Function to remove all edges
+***********************************************************/
+void SnapIndex::clear()
+{
+  edges_.clear();
+  free_edges_.clear();
+  cells_.clear();
+  shapes_.clear();
+  root_    = -1;
+  n_edges_ = 0;
+}
+
+/***********************************************************
+* Function to update the edges of a shape. Open shapes,
+* which are still inserted, contribute their nodes as well.
+* If the nodes have only been moved, just the moved edges
+* are stored again.
+***********************************************************/
+void SnapIndex::update(Shape* s)
+{
+  int N = s->number_of_nodes();
+  int n_edges = (N == 1) ? 1 : (s->complete() && N >= 3) ? N : N - 1;
+
+  auto it = shapes_.find(s);
+
+  if (it != shapes_.end() && it->second.edges.size() == n_edges &&
+      (n_edges == 0 || edges_[it->second.edges[0]].n_nodes == N))
+  {
+    it->second.revision = s->revision();
+
+    for (int e : it->second.edges)
+    {
+      Edge& E = edges_[e];
+      Vec2r a = s->get_node(E.index)->coords();
+      Vec2r b = s->get_node((E.index + 1) % N)->coords();
+
+      if (a == E.a && b == E.b)
+        continue;
+
+      unlink(e);
+      E.a = a;
+      E.b = b;
+      insert(e);
+    }
+    return;
+  }
+
+  remove_edges(s);
+
+  ShapeEntry& entry = shapes_[s];
+  entry.revision = s->revision();
+
+  for (int i = 0; i < n_edges; ++i)
+    entry.edges.push_back( add_edge(s, i) );
+}
+
+/***********************************************************
+* Function to remove a shape from the index
+***********************************************************/
+void SnapIndex::remove(Shape* s)
+{
+  remove_edges(s);
+  shapes_.erase(s);
+}
+
+/***********************************************************
+* Function to build the index of all shapes
+***********************************************************/
+void SnapIndex::build(ModelSpace& space, Shape* extra)
+{
+  clear();
+  sync(space, extra);
+}
+
+/***********************************************************
+* Function to update all modified, new and removed shapes
+***********************************************************/
+void SnapIndex::sync(ModelSpace& space, Shape* extra)
+{
+  TRACE_ZONE("SnapIndex::sync");
+
+  std::unordered_set<Shape*> present;
+
+  auto check = [&](Shape* s)
+  {
+    present.insert(s);
+
+    auto it = shapes_.find(s);
+    if (it == shapes_.end() || it->second.revision != s->revision())
+      update(s);
+  };
+
+  for (auto shapes : {&space.extr_shapes(), &space.intr_shapes()})
+    for (auto s : *shapes)
+      check(s);
+
+  if (extra)
+    check(extra);
+
+  if (present.size() == shapes_.size())
+    return;
+
+  std::vector<Shape*> removed;
+  for (auto& entry : shapes_)
+    if (present.count(entry.first) == 0)
+      removed.push_back(entry.first);
+
+  for (auto s : removed)
+    remove(s);
+}
+
+/***********************************************************
+* Function to collect all edges, whose bounding box
+* overlaps the box (lo, hi)
+***********************************************************/
+void SnapIndex::query(const Vec2r& lo, const Vec2r& hi,
+                      std::vector<int>& found) const
+{
+  if (root_ < 0)
+    return;
+
+  std::vector<int> stack { root_ };
+
+  while (!stack.empty())
+  {
+    const Cell& C = cells_[stack.back()];
+    stack.pop_back();
+
+    // Loose bounds of the cell
+    Real h = 0.5f * (C.hi[0] - C.lo[0]);
+    if (!boxes_overlap(C.lo - h, C.hi + h, lo, hi))
+      continue;
+
+    for (int e : C.edges)
+    {
+      const Edge& E = edges_[e];
+      if (boxes_overlap(bbox_min(E.a, E.b), bbox_max(E.a, E.b), lo, hi))
+        found.push_back(e);
+    }
+
+    if (C.child >= 0)
+      for (int i = 0; i < 4; ++i)
+        stack.push_back(C.child + i);
+  }
+}
+
+/***********************************************************
+* Function returns the snap target within a radius around
+* the point p
+***********************************************************/
+SnapTarget SnapIndex::snap(const Vec2r& p, Real radius,
+                           const Shape* skip_shape,
+                           const Node*  skip_node) const
+{
+  SnapTarget target;
+
+  std::vector<int> found;
+  query(p - radius, p + radius, found);
+
+  // Edges within the radius, which are not excluded
+  std::vector<std::pair<Real, int>> near;
+
+  for (int e : found)
+  {
+    const Edge& E = edges_[e];
+
+    if (E.shape == skip_shape)
+      continue;
+
+    if (skip_node && E.shape == &skip_node->parent())
+    {
+      int k = skip_node->index();
+      if (E.index == k || (E.index + 1) % E.n_nodes == k)
+        continue;
+    }
+
+    Real d = Real((p - closest_point(p, E.a, E.b)).length());
+    if (d <= radius)
+      near.push_back( { d, e } );
+  }
+
+  if (near.empty())
+    return target;
+
+  if (near.size() > max_near)
+  {
+    std::nth_element(near.begin(), near.begin() + max_near, near.end());
+    near.resize(max_near);
+  }
+
+  // Keep the nearest candidate of a kind
+  Real best = radius;
+  auto consider = [&](SnapType type, const Vec2r& c)
+  {
+    Real d = Real((p - c).length());
+    if (d <= best)
+    {
+      best = d;
+      target.type   = type;
+      target.coords = c;
+    }
+  };
+
+  // Nodes
+  for (auto& n : near)
+  {
+    consider(SnapType::Node, edges_[n.second].a);
+    consider(SnapType::Node, edges_[n.second].b);
+  }
+  if (target.type != SnapType::Grid)
+    return target;
+
+  // Intersections of two edges
+  for (int i = 0; i < near.size(); ++i)
+    for (int j = i + 1; j < near.size(); ++j)
+    {
+      const Edge& E = edges_[near[i].second];
+      const Edge& F = edges_[near[j].second];
+
+      Vec2r r = E.b - E.a;
+      Vec2r s = F.b - F.a;
+      Real denom = cross(r, s);
+
+      if (std::fabs(denom) <= 1.0e-12f)
+        continue;
+
+      Real t = cross(F.a - E.a, s) / denom;
+      Real u = cross(F.a - E.a, r) / denom;
+
+      if (t >= 0.0f && t <= 1.0f && u >= 0.0f && u <= 1.0f)
+        consider(SnapType::Intersection, E.a + r * t);
+    }
+  if (target.type != SnapType::Grid)
+    return target;
+
+  // Edge midpoints
+  for (auto& n : near)
+    consider(SnapType::Midpoint,
+             (edges_[n.second].a + edges_[n.second].b) * 0.5f);
+  if (target.type != SnapType::Grid)
+    return target;
+
+  // Closest points on edges
+  best = radius;
+  for (auto& n : near)
+    consider(SnapType::Edge,
+             closest_point(p, edges_[n.second].a, edges_[n.second].b));
+
+  return target;
+}
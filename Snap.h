@@ -0,0 +1,119 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "Vec2.h"
+
+class Shape;
+class Node;
+class ModelSpace;
+
+/***********************************************************
+* Kinds of snap targets, ordered by their priority. 
+* Without any object nearby, the cursor stays on the grid.
+***********************************************************/
+enum class SnapType {
+  Grid,
+  Node,
+  Intersection,
+  Midpoint,
+  Edge
+};
+
+struct SnapTarget
+{
+  SnapType  type = SnapType::Grid;
+  Vec2r     coords;
+};
+
+/***********************************************************
+* Spatial index of the shape edges for object snapping.
+*
+* The edges are stored in a loose quadtree: every cell
+* covers twice the area of its box, and an edge is stored
+* in the smallest cell, whose box contains the center of
+* the edge and whose size is not below the extent of the
+* edge. Queries within a radius thus visit O(log n) cells
+* for evenly sized edges. Changes of single shapes only
+* replace the edges of these shapes.
+*
+* A query returns the node, edge intersection, edge
+* midpoint or point on an edge within the radius, in this
+* order of priority, with the nearest one of each kind.
+***********************************************************/
+class SnapIndex
+{
+public:
+  SnapIndex() {}
+  ~SnapIndex() {}
+
+  /*********************************************************
+  * Updates
+  *********************************************************/
+  void build(ModelSpace& space, Shape* extra = nullptr);
+
+  // Update all shapes, that have been modified, added or
+  // removed since the last call. An extra shape, which is
+  // not part of the model yet, may be included.
+  void sync(ModelSpace& space, Shape* extra = nullptr);
+
+  void update(Shape* s);
+  void remove(Shape* s);
+  void clear();
+
+  /*********************************************************
+  * Queries, the edges of a shape or next to a node, which
+  * are currently moved, can be excluded
+  *********************************************************/
+  SnapTarget snap(const Vec2r& p, Real radius,
+                  const Shape* skip_shape = nullptr,
+                  const Node*  skip_node  = nullptr) const;
+
+  int number_of_edges() const { return n_edges_; }
+
+private:
+  struct Edge
+  {
+    Shape*  shape;
+    int     index;
+    int     n_nodes;
+    Vec2r   a;
+    Vec2r   b;
+    int     cell;
+    int     slot;
+    bool    alive;
+  };
+
+  struct Cell
+  {
+    Vec2r             lo;
+    Vec2r             hi;
+    int               child = -1;   // First of four children
+    std::vector<int>  edges;
+  };
+
+  struct ShapeEntry
+  {
+    unsigned          revision;
+    std::vector<int>  edges;
+  };
+
+  int     n_edges_ = 0;
+
+  std::vector<Edge>   edges_;
+  std::vector<int>    free_edges_;
+  std::vector<Cell>   cells_;
+  int                 root_ = -1;
+
+  std::unordered_map<Shape*, ShapeEntry> shapes_;
+
+  int  add_cell(const Vec2r& lo, const Vec2r& hi);
+  void grow(const Vec2r& p, Real w_min);
+  void insert(int e);
+  int  add_edge(Shape* s, int i);
+  void unlink(int e);
+  void remove_edges(Shape* s);
+  void query(const Vec2r& lo, const Vec2r& hi,
+             std::vector<int>& found) const;
+};
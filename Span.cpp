@@ -0,0 +1,167 @@
+#include "Span.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SPAN_X86
+#endif
+
+/***********************************************************
+* Portable versions
+***********************************************************/
+static void fill_scalar(olc::Pixel* p, int n, olc::Pixel color)
+{
+  std::fill(p, p + n, color);
+}
+
+static void blend_scalar(olc::Pixel* p, int n, olc::Pixel color)
+{
+  uint32_t a  = color.a;
+  uint32_t ia = 255 - a;
+  uint32_t r  = color.r * a;
+  uint32_t g  = color.g * a;
+  uint32_t b  = color.b * a;
+
+  for (int i = 0; i < n; ++i)
+  {
+    p[i].r = (r + p[i].r * ia + 127) / 255;
+    p[i].g = (g + p[i].g * ia + 127) / 255;
+    p[i].b = (b + p[i].b * ia + 127) / 255;
+  }
+}
+
+#ifdef SPAN_X86
+
+/***********************************************************
+* AVX2 versions. The target is aligned to 32 bytes first,
+* then four registers of eight pixels are stored per
+* iteration.
+***********************************************************/
+__attribute__((target("avx2")))
+static void fill_avx2(olc::Pixel* p, int n, olc::Pixel color)
+{
+  int i = 0;
+
+  for (; i < n && (reinterpret_cast<uintptr_t>(p + i) & 31); ++i)
+    p[i] = color;
+
+  __m256i c = _mm256_set1_epi32(int(color.n));
+
+  for (; i + 32 <= n; i += 32)
+  {
+    __m256i* q = reinterpret_cast<__m256i*>(p + i);
+    _mm256_store_si256(q,     c);
+    _mm256_store_si256(q + 1, c);
+    _mm256_store_si256(q + 2, c);
+    _mm256_store_si256(q + 3, c);
+  }
+
+  for (; i + 8 <= n; i += 8)
+    _mm256_store_si256(reinterpret_cast<__m256i*>(p + i), c);
+
+  for (; i < n; ++i)
+    p[i] = color;
+}
+
+/***********************************************************
+* The channels are widened to 16 bits, where
+*   (c * a + p * (255 - a) + 127) / 255
+* is computed exactly with (x + 1 + (x >> 8)) >> 8.
+* The alpha channel is multiplied by 255, which keeps it.
+***********************************************************/
+__attribute__((target("avx2")))
+static inline __m256i div255_avx2(__m256i x)
+{
+  __m256i one = _mm256_set1_epi16(1);
+  __m256i hi  = _mm256_srli_epi16(x, 8);
+  x = _mm256_add_epi16(x, _mm256_add_epi16(one, hi));
+  return _mm256_srli_epi16(x, 8);
+}
+
+__attribute__((target("avx2")))
+static void blend_avx2(olc::Pixel* p, int n, olc::Pixel color)
+{
+  uint16_t a  = color.a;
+  uint16_t ia = 255 - a;
+
+  __m256i mul = _mm256_setr_epi16(ia, ia, ia, 255, ia, ia, ia, 255,
+                                  ia, ia, ia, 255, ia, ia, ia, 255);
+
+  uint16_t r = color.r * a + 127;
+  uint16_t g = color.g * a + 127;
+  uint16_t b = color.b * a + 127;
+
+  __m256i add = _mm256_setr_epi16(r, g, b, 127, r, g, b, 127,
+                                  r, g, b, 127, r, g, b, 127);
+
+  __m256i zero = _mm256_setzero_si256();
+
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8)
+  {
+    __m256i* q = reinterpret_cast<__m256i*>(p + i);
+    __m256i  v = _mm256_loadu_si256(q);
+
+    __m256i lo = _mm256_unpacklo_epi8(v, zero);
+    __m256i hi = _mm256_unpackhi_epi8(v, zero);
+
+    lo = _mm256_add_epi16(_mm256_mullo_epi16(lo, mul), add);
+    hi = _mm256_add_epi16(_mm256_mullo_epi16(hi, mul), add);
+
+    lo = div255_avx2(lo);
+    hi = div255_avx2(hi);
+
+    _mm256_storeu_si256(q, _mm256_packus_epi16(lo, hi));
+  }
+
+  blend_scalar(p + i, n - i, color);
+}
+
+static bool has_avx2()
+{
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  return avx2;
+}
+
+#endif
+
+/***********************************************************
+* Function to store a color into a span of pixels
+***********************************************************/
+void fill_span(olc::Pixel* row, int x0, int x1, olc::Pixel color)
+{
+  if (x0 >= x1)
+    return;
+
+#ifdef SPAN_X86
+  if (has_avx2())
+  {
+    fill_avx2(row + x0, x1 - x0, color);
+    return;
+  }
+#endif
+
+  fill_scalar(row + x0, x1 - x0, color);
+}
+
+/***********************************************************
+* Function to blend a color onto a span of pixels
+***********************************************************/
+void blend_span(olc::Pixel* row, int x0, int x1, olc::Pixel color)
+{
+  if (x0 >= x1)
+    return;
+
+#ifdef SPAN_X86
+  if (has_avx2())
+  {
+    blend_avx2(row + x0, x1 - x0, color);
+    return;
+  }
+#endif
+
+  blend_scalar(row + x0, x1 - x0, color);
+}
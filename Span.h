@@ -0,0 +1,32 @@
+#pragma once
+
+#include "olc_pixel_game_engine.h"
+
+/***********************************************************
+* Primitives to write horizontal spans of pixels.
+*
+* Unlike PixelGameEngine::Draw, the pixel mode is decided
+* once per span: opaque colors are stored, colors with an
+* alpha value below 255 are blended onto the target.
+* On x86 processors with AVX2, eight pixels are written per
+* instruction, the remaining pixels one at a time. The
+* instruction set is detected at runtime, such that the
+* program runs on any processor.
+***********************************************************/
+
+// Store the color into row[x0] ... row[x1-1]
+void fill_span(olc::Pixel* row, int x0, int x1, olc::Pixel color);
+
+// Blend the color onto row[x0] ... row[x1-1], keeps the
+// alpha values of the target
+void blend_span(olc::Pixel* row, int x0, int x1, olc::Pixel color);
+
+// Either of both, depending on the alpha value of the color
+inline void write_span(olc::Pixel* row, int x0, int x1,
+                       olc::Pixel color)
+{
+  if (color.a == 255)
+    fill_span(row, x0, x1, color);
+  else
+    blend_span(row, x0, x1, color);
+}
@@ -0,0 +1,218 @@
+#include "TaskPool.h"
+
+#include <algorithm>
+
+/***********************************************************
+* Pool and deque index of the calling worker thread
+***********************************************************/
+static thread_local TaskPool* current_pool  = nullptr;
+static thread_local int       current_index = -1;
+
+static int configured_threads = 0;
+
+/***********************************************************
+* Constructor: starts the worker threads
+***********************************************************/
+TaskPool::TaskPool(int n_threads)
+{
+  if (n_threads < 1)
+    n_threads = 1;
+
+  for (int i = 0; i < n_threads; ++i)
+    queues_.push_back( std::make_unique<Queue>() );
+
+  for (int i = 0; i < n_threads; ++i)
+    threads_.emplace_back(&TaskPool::worker, this, i);
+}
+
+/***********************************************************
+* Destructor: finishes all queued tasks and stops workers
+***********************************************************/
+TaskPool::~TaskPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stop_ = true;
+  }
+  sleep_cv_.notify_all();
+
+  for (auto& t : threads_)
+    t.join();
+}
+
+/***********************************************************
+* Shared pool of the application
+***********************************************************/
+TaskPool& TaskPool::instance()
+{
+  static TaskPool pool( configured_threads > 0
+                      ? configured_threads
+                      : std::thread::hardware_concurrency() );
+  return pool;
+}
+
+void TaskPool::configure(int n_threads)
+{
+  configured_threads = n_threads;
+}
+
+/***********************************************************
+* Function to submit a new task
+***********************************************************/
+void TaskPool::submit(Task task, TaskGroup* group)
+{
+  if (group)
+  {
+    group->count_++;
+    task = [task, group]() { task(); group->count_--; };
+  }
+
+  int index = (current_pool == this)
+            ? current_index
+            : next_queue_++ % queues_.size();
+
+  {
+    std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+    queues_[index]->tasks.push_back( { std::move(task), group } );
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    pending_++;
+  }
+  sleep_cv_.notify_one();
+}
+
+/***********************************************************
+* Function to wait for all tasks of a group. The calling
+* thread processes queued tasks of the group meanwhile.
+***********************************************************/
+void TaskPool::wait(TaskGroup& group)
+{
+  int index = (current_pool == this) ? current_index : 0;
+  Task task;
+
+  while (!group.done())
+  {
+    if (take(index, group, task))
+    {
+      pending_--;
+      task();
+    }
+    else
+      std::this_thread::yield();
+  }
+}
+
+/***********************************************************
+* Function to take the newest task from the own deque
+***********************************************************/
+bool TaskPool::pop(int index, Task& task)
+{
+  Queue& q = *queues_[index];
+  std::lock_guard<std::mutex> lock(q.mutex);
+
+  if (q.tasks.empty())
+    return false;
+
+  task = std::move(q.tasks.back().task);
+  q.tasks.pop_back();
+  return true;
+}
+
+/***********************************************************
+* Function to take the oldest task from another deque
+***********************************************************/
+bool TaskPool::steal(int index, Task& task)
+{
+  int n = queues_.size();
+
+  for (int i = 1; i < n; ++i)
+  {
+    Queue& q = *queues_[(index + i) % n];
+    std::lock_guard<std::mutex> lock(q.mutex);
+
+    if (q.tasks.empty())
+      continue;
+
+    task = std::move(q.tasks.front().task);
+    q.tasks.pop_front();
+    return true;
+  }
+
+  return false;
+}
+
+/***********************************************************
+* Function to take a task of the given group, the newest
+* one from the own deque or the oldest one from the others
+***********************************************************/
+bool TaskPool::take(int index, const TaskGroup& group, Task& task)
+{
+  int n = queues_.size();
+
+  for (int i = 0; i < n; ++i)
+  {
+    Queue& q = *queues_[(index + i) % n];
+    std::lock_guard<std::mutex> lock(q.mutex);
+
+    auto match = [&](const Entry& e) { return e.group == &group; };
+
+    if (i == 0)
+    {
+      auto it = std::find_if(q.tasks.rbegin(), q.tasks.rend(), match);
+      if (it == q.tasks.rend())
+        continue;
+
+      task = std::move(it->task);
+      q.tasks.erase(std::next(it).base());
+      return true;
+    }
+
+    auto it = std::find_if(q.tasks.begin(), q.tasks.end(), match);
+    if (it == q.tasks.end())
+      continue;
+
+    task = std::move(it->task);
+    q.tasks.erase(it);
+    return true;
+  }
+
+  return false;
+}
+
+/***********************************************************
+* Function to run a single task, if one is available
+***********************************************************/
+bool TaskPool::run_one(int index)
+{
+  Task task;
+
+  if (!pop(index, task) && !steal(index, task))
+    return false;
+
+  pending_--;
+  task();
+  return true;
+}
+
+/***********************************************************
+* Worker thread loop
+***********************************************************/
+void TaskPool::worker(int index)
+{
+  current_pool  = this;
+  current_index = index;
+
+  while (true)
+  {
+    if (run_one(index))
+      continue;
+
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    sleep_cv_.wait(lock, [this]() { return stop_ || pending_ > 0; });
+
+    if (stop_ && pending_ == 0)
+      return;
+  }
+}
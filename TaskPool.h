@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+* Counter of unfinished tasks, which can be waited for
+***********************************************************/
+class TaskGroup
+{
+public:
+  bool done() const { return count_.load() == 0; }
+
+private:
+  friend class TaskPool;
+  std::atomic<int> count_ { 0 };
+};
+
+/***********************************************************
+* Work-stealing task scheduler
+* Every worker owns a deque of tasks. Tasks that are
+* submitted from a worker go to its own deque and are
+* processed in LIFO order, idle workers steal the oldest
+* tasks from the other deques. Tasks from other threads
+* are distributed round-robin.
+* Threads that wait for a task group help to process the
+* tasks of this group only, so tasks may submit and wait
+* for nested tasks without running unrelated long tasks
+* inline.
+***********************************************************/
+class TaskPool
+{
+public:
+  using Task = std::function<void()>;
+
+  TaskPool(int n_threads);
+  ~TaskPool();
+
+  /*--------------------------------------------------------
+  | Shared pool of the application. The number of threads
+  | must be configured before its first use, it defaults
+  | to the number of cores.
+  --------------------------------------------------------*/
+  static TaskPool& instance();
+  static void configure(int n_threads);
+
+  int size() const { return threads_.size(); }
+
+  /*--------------------------------------------------------
+  | Task submission
+  --------------------------------------------------------*/
+  void submit(Task task, TaskGroup* group = nullptr);
+  void wait(TaskGroup& group);
+
+  /*--------------------------------------------------------
+  | Call f(i) for all i in [begin, end) and wait for all
+  | calls to finish. Indices are processed in chunks of
+  | <grain> elements.
+  --------------------------------------------------------*/
+  template <typename F>
+  void parallel_for(int begin, int end, F f, int grain = 1)
+  {
+    TaskGroup group;
+    grain = grain < 1 ? 1 : grain;
+
+    for (int i = begin; i < end; i += grain)
+    {
+      int chunk_end = (i + grain < end) ? i + grain : end;
+      submit([i, chunk_end, &f]()
+      {
+        for (int j = i; j < chunk_end; ++j)
+          f(j);
+      }, &group);
+    }
+
+    wait(group);
+  }
+
+private:
+  struct Entry
+  {
+    Task        task;
+    TaskGroup*  group;
+  };
+
+  struct Queue
+  {
+    std::mutex        mutex;
+    std::deque<Entry> tasks;
+  };
+
+  bool pop(int index, Task& task);
+  bool steal(int index, Task& task);
+  bool take(int index, const TaskGroup& group, Task& task);
+  bool run_one(int index);
+  void worker(int index);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread>            threads_;
+
+  std::atomic<int>                    pending_ { 0 };
+  std::atomic<unsigned>               next_queue_ { 0 };
+  std::atomic<bool>                   stop_ { false };
+  std::mutex                          sleep_mutex_;
+  std::condition_variable             sleep_cv_;
+};
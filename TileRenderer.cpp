@@ -0,0 +1,709 @@
+#include "TileRenderer.h"
+#include "TaskPool.h"
+#include "Trace.h"
+#include "Vec2.h"
+
+#include <cmath>
+#include <cstdlib>
+
+/***********************************************************
+* Integer division, rounded towards -inf or +inf
+***********************************************************/
+static int64_t floor_div(int64_t a, int64_t b)
+{
+  return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+static int64_t ceil_div(int64_t a, int64_t b)
+{
+  return -floor_div(-a, b);
+}
+
+/***********************************************************
+* Function to write a single pixel of a row
+***********************************************************/
+static void put(olc::Pixel* row, int W, int x, olc::Pixel p)
+{
+  if (x < 0 || x >= W)
+    return;
+
+  if (p.a == 255)
+    row[x] = p;
+  else
+    write_span(row, x, x + 1, p);
+}
+
+/***********************************************************
+* Constructor / Destructor
+***********************************************************/
+TileRenderer::TileRenderer(olc::PixelGameEngine& pge)
+: pge_{pge}
+{}
+
+TileRenderer::~TileRenderer() {}
+
+/***********************************************************
+* Function to start the recording of a frame
+***********************************************************/
+void TileRenderer::begin(olc::Sprite* target)
+{
+  if (!font_loaded_)
+    load_font();
+
+  target_ = target;
+  commands_.clear();
+  texts_.clear();
+  rasters_.clear();
+  lines_.clear();
+
+  int H = target ? target->height : 0;
+  bins_.resize( (maximum(H, 0) + band_height - 1) / band_height );
+
+  for (auto& b : bins_)
+    b.clear();
+}
+
+/***********************************************************
+* Function to rasterize all recorded commands
+***********************************************************/
+void TileRenderer::end()
+{
+  TRACE_ZONE("TileRenderer::end");
+
+  if (!target_)
+    return;
+
+  int n_bands = bins_.size();
+  TaskPool& pool = TaskPool::instance();
+
+  if (pool.size() > 0 && n_bands > 1)
+  {
+    // The calling thread processes the bands, which are not
+    // taken by idle workers, so the frame does not wait for
+    // background jobs running on the pool
+    pool.parallel_for(0, n_bands, [this](int b)
+    { render_band(b); });
+  }
+  else
+  {
+    for (int b = 0; b < n_bands; ++b)
+      render_band(b);
+  }
+
+  target_ = nullptr;
+}
+
+/***********************************************************
+* Function to add a command to all bands of its rows
+***********************************************************/
+void TileRenderer::record(const Command& c, int y_min, int y_max)
+{
+  if (!target_)
+    return;
+
+  y_min = maximum(y_min, 0);
+  y_max = minimum(y_max, target_->height - 1);
+
+  if (y_min > y_max)
+    return;
+
+  int index = commands_.size();
+  commands_.push_back(c);
+
+  for (int b = y_min / band_height; b <= y_max / band_height; ++b)
+    bins_[b].push_back(index);
+}
+
+/***********************************************************
+* Drawing commands
+***********************************************************/
+void TileRenderer::clear(olc::Pixel p)
+{
+  if (!target_)
+    return;
+
+  // All previous commands are overdrawn
+  commands_.clear();
+  for (auto& b : bins_)
+    b.clear();
+
+  record( { Op::Clear, p }, 0, target_->height - 1 );
+}
+
+void TileRenderer::draw(int x, int y, olc::Pixel p)
+{
+  record( { Op::Point, p, x, y }, y, y );
+}
+
+void TileRenderer::draw_line(int x0, int y0, int x1, int y1,
+                             olc::Pixel p, uint32_t pattern)
+{
+  record( { Op::Line, p, x0, y0, x1, y1, pattern },
+          minimum(y0, y1), maximum(y0, y1) );
+}
+
+void TileRenderer::draw_line_aa(const Vec2f& a, const Vec2f& b,
+                                olc::Pixel p)
+{
+  Command c = { Op::LineAA, p };
+  c.index = lines_.size();
+  lines_.push_back( { a, b } );
+
+  record( c, int(std::floor(minimum(a[1], b[1]))) - 1,
+             int(std::floor(maximum(a[1], b[1]))) + 1 );
+}
+
+void TileRenderer::draw_circle(int x, int y, int radius,
+                               olc::Pixel p)
+{
+  if (radius < 0)
+    return;
+
+  record( { Op::Circle, p, x, y, radius }, y - radius, y + radius );
+}
+
+void TileRenderer::fill_circle(int x, int y, int radius,
+                               olc::Pixel p)
+{
+  if (radius < 0)
+    return;
+
+  record( { Op::FillCircle, p, x, y, radius },
+          y - radius, y + radius );
+}
+
+void TileRenderer::draw_string(int x, int y, const std::string& text,
+                               olc::Pixel p, int scale)
+{
+  int lines = 1;
+  for (auto c : text)
+    if (c == '\n')
+      ++lines;
+
+  Command c = { Op::String, p, x, y, maximum(scale, 1) };
+  c.index = texts_.size();
+  texts_.push_back(text);
+
+  record( c, y, y + lines * 8 * c.x1 - 1 );
+}
+
+void TileRenderer::fill(Rasterizer& raster, olc::Pixel p,
+                        FillRule rule)
+{
+  if (!target_)
+    return;
+
+  // The edge table is shared by all bands
+  raster.prepare(target_->width, target_->height);
+
+  Command c = { Op::Fill, p };
+  c.index = rasters_.size();
+  c.rule  = rule;
+  rasters_.push_back(&raster);
+
+  record( c, 0, target_->height - 1 );
+}
+
+/***********************************************************
+* Function to copy the glyphs of the engine font, which is
+* drawn once into an offscreen sprite
+***********************************************************/
+void TileRenderer::load_font()
+{
+  olc::Sprite  sheet(128, 48);
+  olc::Sprite* target = pge_.GetDrawTarget();
+
+  pge_.SetDrawTarget(&sheet);
+  pge_.Clear(olc::BLANK);
+
+  for (int c = 32; c < 128; ++c)
+    pge_.DrawString( (c - 32) % 16 * 8, (c - 32) / 16 * 8,
+                     std::string(1, char(c)), olc::WHITE );
+
+  pge_.SetDrawTarget(target);
+
+  for (int g = 0; g < 96; ++g)
+    for (int j = 0; j < 8; ++j)
+    {
+      uint8_t bits = 0;
+      for (int i = 0; i < 8; ++i)
+        if (sheet.GetPixel(g % 16 * 8 + i, g / 16 * 8 + j).r > 0)
+          bits |= 1 << i;
+      glyphs_[g][j] = bits;
+    }
+
+  font_loaded_ = true;
+}
+
+/***********************************************************
+* Function to rasterize a line within the rows [r0, r1).
+* Follows the Bresenham variant of the engine, but starts
+* at the first row of the band: after k steps along the
+* major axis, the number of steps along the minor axis
+* follows directly from the decision variable.
+***********************************************************/
+static void draw_line_rows(olc::Pixel* data, int W, int r0, int r1,
+                           int x1, int y1, int x2, int y2,
+                           olc::Pixel p, uint32_t pattern)
+{
+  auto bit = [pattern](int64_t i)
+  { return (pattern >> (31 - int(i % 32))) & 1u; };
+
+  int dx = x2 - x1;
+  int dy = y2 - y1;
+
+  if (dx == 0)
+  {
+    if (y2 < y1)
+      std::swap(y1, y2);
+    for (int y = maximum(y1, r0); y <= minimum(y2, r1 - 1); ++y)
+      if (bit(y - y1))
+        put(data + y * W, W, x1, p);
+    return;
+  }
+
+  if (dy == 0)
+  {
+    if (y1 < r0 || y1 >= r1)
+      return;
+    if (x2 < x1)
+      std::swap(x1, x2);
+    for (int x = maximum(x1, 0); x <= minimum(x2, W - 1); ++x)
+      if (bit(x - x1))
+        put(data + y1 * W, W, x, p);
+    return;
+  }
+
+  int64_t dx1 = std::abs(dx);
+  int64_t dy1 = std::abs(dy);
+  int step = ((dx < 0 && dy < 0) || (dx > 0 && dy > 0)) ? 1 : -1;
+
+  if (dy1 <= dx1)
+  {
+    int xs = (dx >= 0) ? x1 : x2;
+    int ys = (dx >= 0) ? y1 : y2;
+
+    // Number of steps along y after k steps along x
+    int64_t A = 2 * dy1, B = 2 * dx1, p0 = 2 * dy1 - dx1;
+    auto m = [&](int64_t k)
+    { return floor_div(p0 + (k - 1) * A, B) + 1; };
+
+    int64_t m_lo = (step > 0) ? r0 - ys : ys - (r1 - 1);
+    int64_t m_hi = (step > 0) ? r1 - 1 - ys : ys - r0;
+
+    // First step with m(k) >= m_lo and last with m(k) <= m_hi
+    int64_t lo = 0, hi = dx1 + 1;
+    while (lo < hi)
+    {
+      int64_t k = (lo + hi) / 2;
+      if (m(k) >= m_lo) hi = k; else lo = k + 1;
+    }
+    int64_t k_begin = lo;
+
+    lo = 0; hi = dx1 + 1;
+    while (lo < hi)
+    {
+      int64_t k = (lo + hi) / 2;
+      if (m(k) > m_hi) hi = k; else lo = k + 1;
+    }
+    int64_t k_end = lo;
+
+    k_begin = maximum(k_begin, int64_t(-xs));
+    k_end   = minimum(k_end,   int64_t(W - xs));
+
+    // Continue with the decision variable of the engine
+    int64_t mk = m(k_begin);
+    int64_t px = p0 + k_begin * A - mk * B;
+
+    for (int64_t k = k_begin; k < k_end; ++k)
+    {
+      if (bit(k))
+        put(data + (ys + step * mk) * W, W, xs + k, p);
+
+      if (px < 0)
+        px += A;
+      else
+      {
+        ++mk;
+        px += A - B;
+      }
+    }
+  }
+  else
+  {
+    int xs = (dy >= 0) ? x1 : x2;
+    int ys = (dy >= 0) ? y1 : y2;
+
+    // Number of steps along x after k steps along y
+    int64_t A = 2 * dx1, B = 2 * dy1, p0 = 2 * dx1 - dy1;
+
+    int64_t k_begin = maximum(int64_t(0), int64_t(r0 - ys));
+    int64_t k_end   = minimum(dy1 + 1, int64_t(r1 - ys));
+
+    int64_t mk = ceil_div(p0 + (k_begin - 1) * A, B);
+    int64_t py = p0 + k_begin * A - mk * B;
+
+    for (int64_t k = k_begin; k < k_end; ++k)
+    {
+      if (bit(k))
+        put(data + (ys + k) * W, W, xs + step * mk, p);
+
+      if (py <= 0)
+        py += A;
+      else
+      {
+        ++mk;
+        py += A - B;
+      }
+    }
+  }
+}
+
+/***********************************************************
+* Coverage of the anti-aliased lines of a band. Lines are
+* composited into premultiplied samples, which are written
+* onto the target by a single resolve pass.
+***********************************************************/
+struct Accumulator
+{
+  struct Sample { float r, g, b, a; };
+
+  std::vector<Sample> samples;   // All zero outside of resolve
+
+  int W     = 0;
+  int r0    = 0;
+  int rows  = 0;
+  int x_min = 0, x_max = -1;     // Region with coverage
+  int y_min = 0, y_max = -1;
+
+  void reset(int width, int first_row, int n_rows)
+  {
+    if (samples.size() < width * n_rows)
+      samples.assign(width * n_rows, Sample { 0.0f, 0.0f, 0.0f, 0.0f });
+
+    W    = width;
+    r0   = first_row;
+    rows = n_rows;
+    clear_region();
+  }
+
+  void clear_region()
+  {
+    x_min = W;         x_max = -1;
+    y_min = r0 + rows; y_max = -1;
+  }
+
+  bool empty() const { return x_min > x_max; }
+
+  // Premultiplied color of a line with full coverage
+  static Sample color(olc::Pixel p)
+  {
+    float a = p.a / 255.0f;
+    return Sample { a * p.r, a * p.g, a * p.b, a };
+  }
+
+  void add(int x, int y, float coverage, const Sample& c)
+  {
+    if (x < 0 || x >= W)
+      return;
+
+    x_min = minimum(x_min, x); x_max = maximum(x_max, x);
+    y_min = minimum(y_min, y); y_max = maximum(y_max, y);
+
+    float ia = 1.0f - coverage * c.a;
+    Sample& s = samples[(y - r0) * W + x];
+    s.r = coverage * c.r + ia * s.r;
+    s.g = coverage * c.g + ia * s.g;
+    s.b = coverage * c.b + ia * s.b;
+    s.a = coverage * c.a + ia * s.a;
+  }
+
+  void resolve(olc::Pixel* data)
+  {
+    for (int y = y_min; y <= y_max; ++y)
+    {
+      Sample*     s = &samples[(y - r0) * W];
+      olc::Pixel* d = data + y * W;
+
+      for (int x = x_min; x <= x_max; ++x)
+      {
+        if (s[x].a <= 0.0f)
+          continue;
+
+        float ia = 1.0f - s[x].a;
+        d[x].r = uint8_t(s[x].r + ia * d[x].r + 0.5f);
+        d[x].g = uint8_t(s[x].g + ia * d[x].g + 0.5f);
+        d[x].b = uint8_t(s[x].b + ia * d[x].b + 0.5f);
+        s[x] = Sample { 0.0f, 0.0f, 0.0f, 0.0f };
+      }
+    }
+
+    clear_region();
+  }
+};
+
+/***********************************************************
+* Function to rasterize an anti-aliased line within the 
+* rows [r0, r1), following Wu: every pixel along the major
+* axis splits its coverage between the two pixels next to
+* the line. End pixels are weighted by their overlap with
+* the line.
+***********************************************************/
+template <typename Plot>
+static void draw_line_aa_rows(int W, int r0, int r1, 
+                              Vec2f a, Vec2f b, Plot plot)
+{
+  bool steep = std::fabs(b[1] - a[1]) > std::fabs(b[0] - a[0]);
+
+  // Step along the first coordinate from now on
+  if (steep)
+  {
+    std::swap(a[0], a[1]);
+    std::swap(b[0], b[1]);
+  }
+  if (a[0] > b[0])
+    std::swap(a, b);
+
+  float len = b[0] - a[0];
+  if (!(len > 0.0f))
+    return;
+
+  float slope = (b[1] - a[1]) / len;
+
+  // Pixel ranges along the major and the minor axis
+  int i_lo = steep ? r0 : 0;
+  int i_hi = steep ? r1 : W;
+  int j_lo = steep ? 0  : r0;
+  int j_hi = steep ? W  : r1;
+
+  // Restrict the major axis to the minor range
+  float u0 = a[0];
+  float u1 = b[0];
+
+  if (slope != 0.0f)
+  {
+    float ua = a[0] + (j_lo - 1 - a[1]) / slope;
+    float ub = a[0] + (j_hi + 1 - a[1]) / slope;
+    if (ua > ub)
+      std::swap(ua, ub);
+    u0 = maximum(u0, ua);
+    u1 = minimum(u1, ub);
+  }
+  else if (a[1] < j_lo - 1 || a[1] > j_hi + 1)
+    return;
+
+  if (!(u0 <= u1))
+    return;
+
+  // Clamped before the conversion to avoid overflows
+  u0 = maximum(u0, float(i_lo - 1));
+  u1 = minimum(u1, float(i_hi + 1));
+
+  int i_begin = maximum(i_lo,     int(std::floor(u0)));
+  int i_end   = minimum(i_hi - 1, int(std::floor(u1)));
+
+  for (int i = i_begin; i <= i_end; ++i)
+  {
+    float w = minimum(float(i + 1), b[0]) - maximum(float(i), a[0]);
+    if (w <= 0.0f)
+      continue;
+
+    float u = maximum(a[0], minimum(b[0], i + 0.5f));
+    float v = a[1] + (u - a[0]) * slope - 0.5f;
+    int   j = int(v);
+    if (j > v)
+      --j;
+    float f = v - j;
+
+    if (j >= j_lo && j < j_hi)
+      steep ? plot(j, i, (1.0f - f) * w) : plot(i, j, (1.0f - f) * w);
+    if (j + 1 >= j_lo && j + 1 < j_hi)
+      steep ? plot(j + 1, i, f * w) : plot(i, j + 1, f * w);
+  }
+}
+
+/***********************************************************
+* Function to rasterize all commands of a band
+***********************************************************/
+void TileRenderer::render_band(int band)
+{
+  olc::Sprite* target = target_;
+  olc::Pixel*  data   = target->GetData();
+
+  int W  = target->width;
+  int r0 = band * band_height;
+  int r1 = minimum(r0 + band_height, target->height);
+
+  auto in_band = [r0, r1](int y) { return y >= r0 && y < r1; };
+
+  auto span = [&](int x0, int x1, int y, olc::Pixel p)
+  {
+    x0 = maximum(x0, 0);
+    x1 = minimum(x1, W - 1);
+    if (in_band(y) && x0 <= x1)
+      write_span(data + y * W, x0, x1 + 1, p);
+  };
+
+  // Anti-aliased lines are collected until the next command
+  // of another kind, which must be drawn above them
+  static thread_local Accumulator acc;
+  acc.reset(W, r0, r1 - r0);
+
+  for (int index : bins_[band])
+  {
+    const Command& c = commands_[index];
+
+    if (c.op != Op::LineAA && !acc.empty())
+      acc.resolve(data);
+
+    switch (c.op)
+    {
+    case Op::Clear:
+      // The rows of a band are a single span
+      fill_span(data + r0 * W, 0, (r1 - r0) * W, c.color);
+      break;
+
+    case Op::Point:
+      put(data + c.y0 * W, W, c.x0, c.color);
+      break;
+
+    case Op::Line:
+      draw_line_rows(data, W, r0, r1, c.x0, c.y0, c.x1, c.y1,
+                     c.color, c.pattern);
+      break;
+
+    case Op::LineAA:
+    {
+      const auto& l = lines_[c.index];
+      Accumulator::Sample color = Accumulator::color(c.color);
+      draw_line_aa_rows(W, r0, r1, l[0], l[1], 
+                        [&](int x, int y, float coverage)
+                        { acc.add(x, y, coverage, color); });
+      break;
+    }
+
+    case Op::Circle:
+    {
+      // Midpoint circle of the engine, one octant at a time
+      int x = c.x0, y = c.y0;
+      int x0 = 0, y0 = c.x1, d = 3 - 2 * c.x1;
+
+      auto dot = [&](int px, int py)
+      { if (in_band(py)) put(data + py * W, W, px, c.color); };
+
+      if (c.x1 == 0)
+      {
+        dot(x, y);
+        break;
+      }
+
+      while (y0 >= x0)
+      {
+        dot(x + x0, y - y0);
+        dot(x + y0, y + x0);
+        dot(x - x0, y + y0);
+        dot(x - y0, y - x0);
+        if (x0 != 0 && x0 != y0)
+        {
+          dot(x + y0, y - x0);
+          dot(x + x0, y + y0);
+          dot(x - y0, y + x0);
+          dot(x - x0, y - y0);
+        }
+
+        if (d < 0)
+          d += 4 * x0++ + 6;
+        else
+          d += 4 * (x0++ - y0--) + 10;
+      }
+      break;
+    }
+
+    case Op::FillCircle:
+    {
+      int x = c.x0, y = c.y0;
+      int x0 = 0, y0 = c.x1, d = 3 - 2 * c.x1;
+
+      if (c.x1 == 0)
+      {
+        span(x, x, y, c.color);
+        break;
+      }
+
+      while (y0 >= x0)
+      {
+        span(x - y0, x + y0, y - x0, c.color);
+        if (x0 > 0)
+          span(x - y0, x + y0, y + x0, c.color);
+
+        if (d < 0)
+          d += 4 * x0++ + 6;
+        else
+        {
+          if (x0 != y0)
+          {
+            span(x - x0, x + x0, y - y0, c.color);
+            span(x - x0, x + x0, y + y0, c.color);
+          }
+          d += 4 * (x0++ - y0--) + 10;
+        }
+      }
+      break;
+    }
+
+    case Op::String:
+    {
+      int scale = c.x1;
+      int sx = 0, sy = 0;
+
+      for (auto ch : texts_[c.index])
+      {
+        if (ch == '\n')
+        {
+          sx = 0;
+          sy += 8 * scale;
+          continue;
+        }
+
+        int g = ch - 32;
+        int gy = c.y0 + sy;
+
+        if (g >= 0 && g < 96 && gy + 8 * scale > r0 && gy < r1)
+        {
+          for (int j = 0; j < 8 * scale; ++j)
+          {
+            int y = gy + j;
+            if (!in_band(y))
+              continue;
+
+            // Runs of set bits are written as one span
+            uint8_t bits = glyphs_[g][j / scale];
+            for (int i = 0; i < 8; ++i)
+            {
+              if (!(bits & (1 << i)))
+                continue;
+
+              int i0 = i;
+              while (i < 8 && (bits & (1 << i)))
+                ++i;
+
+              span(c.x0 + sx + i0 * scale,
+                   c.x0 + sx + i * scale - 1, y, c.color);
+            }
+          }
+        }
+
+        sx += 8 * scale;
+      }
+      break;
+    }
+
+    case Op::Fill:
+      rasters_[c.index]->fill_rows(target, c.color, c.rule, r0, r1);
+      break;
+    }
+  }
+
+  if (!acc.empty())
+    acc.resolve(data);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "olc_pixel_game_engine.h"
+#include "Rasterizer.h"
+#include "Vec2.h"
+
+/***********************************************************
+* Tile-binned renderer for the draw target.
+*
+* Drawing commands are recorded between begin() and end()
+* and binned into bands of screen rows by their bounding
+* box. At end(), the bands are rasterized in parallel on
+* the shared task pool, every band executes its commands
+* in the order of their submission, clipped to its own
+* rows. Thus the result is the same as if the commands were
+* drawn one after another.
+*
+* Bands span the full screen width, since a polygon fill
+* needs the winding number from the left screen border.
+*
+* Lines, circles and text are rasterized like the
+* corresponding functions of the pixel game engine.
+* Anti-aliased lines are accumulated per band and written
+* onto the target in a single resolve pass, before the next
+* command of another kind.
+***********************************************************/
+class TileRenderer
+{
+public:
+  static constexpr int band_height = 32;
+
+  TileRenderer(olc::PixelGameEngine& pge);
+  ~TileRenderer();
+
+  /*********************************************************
+  * Recording of a frame
+  *********************************************************/
+  void begin(olc::Sprite* target);
+  void end();
+
+  /*********************************************************
+  * Drawing commands
+  *********************************************************/
+  void clear(olc::Pixel p);
+  void draw(int x, int y, olc::Pixel p);
+  void draw_line(int x0, int y0, int x1, int y1, olc::Pixel p,
+                 uint32_t pattern = 0xFFFFFFFF);
+
+  // Anti-aliased line between pixel positions, where the
+  // pixel (x, y) covers [x, x+1) x [y, y+1)
+  void draw_line_aa(const Vec2f& a, const Vec2f& b, olc::Pixel p);
+
+  void draw_circle(int x, int y, int radius, olc::Pixel p);
+  void fill_circle(int x, int y, int radius, olc::Pixel p);
+  void draw_string(int x, int y, const std::string& text,
+                   olc::Pixel p, int scale = 1);
+
+  // The rings of the rasterizer must not be changed until
+  // the end of the frame
+  void fill(Rasterizer& raster, olc::Pixel p,
+            FillRule rule = FillRule::NonZero);
+
+  int number_of_commands() const { return commands_.size(); }
+
+private:
+  enum class Op { Clear, Point, Line, LineAA, Circle, 
+                  FillCircle, String, Fill };
+
+  struct Command
+  {
+    Op          op;
+    olc::Pixel  color;
+    int         x0, y0;
+    int         x1, y1;     // Line end, radius or scale
+    uint32_t    pattern;
+    int         index;      // Text, line or rasterizer
+    FillRule    rule;
+  };
+
+  void record(const Command& c, int y_min, int y_max);
+  void render_band(int band);
+  void load_font();
+
+  olc::PixelGameEngine&   pge_;
+  olc::Sprite*            target_ = nullptr;
+
+  std::vector<Command>          commands_;
+  std::vector<std::vector<int>> bins_;
+  std::vector<std::string>      texts_;
+  std::vector<Rasterizer*>      rasters_;
+  std::vector<std::array<Vec2f, 2>> lines_;
+
+  // Rows of the 8x8 glyphs of the characters 32 to 127
+  std::array<std::array<uint8_t, 8>, 96> glyphs_ {};
+  bool                    font_loaded_ = false;
+};
@@ -0,0 +1,115 @@
+#ifdef PIXMODELER_TRACE
+
+#include "Trace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/***********************************************************
+* Registry of all thread buffers. Buffers are kept after
+* their thread has finished, so that its events can still
+* be written.
+***********************************************************/
+static std::mutex registry_mutex;
+static std::vector<std::shared_ptr<TraceBuffer>> registry;
+
+static const std::chrono::steady_clock::time_point epoch
+  = std::chrono::steady_clock::now();
+
+/***********************************************************
+* Function returns the current time since program start
+***********************************************************/
+uint64_t trace::now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now() - epoch).count();
+}
+
+/***********************************************************
+* Function returns the buffer of the calling thread and
+* registers it on first use
+***********************************************************/
+TraceBuffer& trace::thread_buffer()
+{
+  thread_local std::shared_ptr<TraceBuffer> buffer;
+
+  if (!buffer)
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    buffer = std::make_shared<TraceBuffer>(registry.size());
+    registry.push_back(buffer);
+  }
+
+  return *buffer;
+}
+
+/***********************************************************
+* Function to copy the events of the buffer while its
+* thread may keep recording. The writer stores event i 
+* into the slot of event i-capacity before it publishes
+* head i+1, so after the copy all events below the new 
+* head minus capacity plus one may be torn.
+***********************************************************/
+void TraceBuffer::copy(std::vector<TraceEvent>& events) const
+{
+  uint64_t head  = this->head();
+  uint64_t start = (head > capacity) ? head - capacity : 0;
+
+  events.clear();
+  for (uint64_t i = start; i < head; ++i)
+    events.push_back(events_[i & (capacity-1)]);
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  uint64_t after = head_.load(std::memory_order_relaxed);
+  uint64_t valid = (after + 1 > capacity) ? after + 1 - capacity : 0;
+
+  if (valid > start)
+    events.erase(events.begin(), 
+                 events.begin() + std::min<uint64_t>(valid - start,
+                                                     events.size()));
+}
+
+/***********************************************************
+* Function to write all recorded events to a file in the
+* Chrome trace event format
+***********************************************************/
+bool trace::write(const std::string& file)
+{
+  std::ofstream out(file);
+  if (!out)
+    return false;
+
+  std::lock_guard<std::mutex> lock(registry_mutex);
+
+  out << std::fixed << std::setprecision(3);
+  out << "{\"traceEvents\":[\n";
+
+  bool first = true;
+  std::vector<TraceEvent> events;
+
+  for (auto& b : registry)
+  {
+    b->copy(events);
+
+    for (const TraceEvent& e : events)
+    {
+      out << (first ? "" : ",\n")
+          << "{\"name\":\"" << e.name << "\",\"ph\":\"X\""
+          << ",\"ts\":" << e.start / 1000.0
+          << ",\"dur\":" << e.duration / 1000.0
+          << ",\"pid\":1,\"tid\":" << b->tid() << "}";
+      first = false;
+    }
+  }
+
+  out << "\n]}\n";
+
+  return bool(out);
+}
+
+#endif
@@ -0,0 +1,104 @@
+#pragma once
+
+/***********************************************************
+* Timeline tracing in the Chrome trace event format, which
+* can be viewed with chrome://tracing or Perfetto.
+* Only compiled if PIXMODELER_TRACE is defined, otherwise
+* TRACE_ZONE expands to nothing.
+***********************************************************/
+#ifdef PIXMODELER_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+* A single timed zone
+***********************************************************/
+struct TraceEvent
+{
+  const char* name;
+  uint64_t    start;      // [ns] since program start
+  uint64_t    duration;   // [ns]
+};
+
+/***********************************************************
+* Ring buffer of trace events that is written by a single
+* thread only. Readers copy the events without locking,
+* the oldest events are overwritten if the buffer is full.
+* Events, which the writer may have overwritten during the
+* copy, are dropped afterwards.
+***********************************************************/
+class TraceBuffer
+{
+public:
+  static constexpr uint64_t capacity = 1 << 16;
+
+  TraceBuffer(int tid) : tid_{tid} {}
+
+  void push(const TraceEvent& e)
+  {
+    uint64_t i = head_.load(std::memory_order_relaxed);
+    events_[i & (capacity-1)] = e;
+    head_.store(i+1, std::memory_order_release);
+  }
+
+  uint64_t head() const { return head_.load(std::memory_order_acquire); }
+  int tid() const { return tid_; }
+
+  // Copies all intact events in the order of recording
+  void copy(std::vector<TraceEvent>& events) const;
+
+private:
+  int                   tid_;
+  std::atomic<uint64_t> head_ { 0 };
+  TraceEvent            events_[capacity];
+};
+
+/***********************************************************
+* Trace functions
+***********************************************************/
+namespace trace
+{
+  // Current time in [ns] since program start
+  uint64_t now();
+
+  // Buffer of the calling thread
+  TraceBuffer& thread_buffer();
+
+  // Write all recorded events as Chrome trace JSON
+  bool write(const std::string& file);
+}
+
+/***********************************************************
+* Zone that records its lifetime as a trace event
+***********************************************************/
+class TraceZone
+{
+public:
+  TraceZone(const char* name)
+  : name_{name}, start_{trace::now()} {}
+
+  ~TraceZone()
+  {
+    trace::thread_buffer().push( { name_, start_,
+                                   trace::now() - start_ } );
+  }
+
+private:
+  const char* name_;
+  uint64_t    start_;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_ZONE(name) \
+  TraceZone TRACE_CONCAT(trace_zone_, __LINE__)(name)
+
+#else
+
+#define TRACE_ZONE(name)
+
+#endif
@@ -0,0 +1,481 @@
+#include "Triangulation.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+/***********************************************************
+* The sweep runs over sheared coordinates y' = y + eps*x.
+* This resolves vertices with equal y-values (which are the
+* rule for shapes snapped to the grid), such that there are
+* no horizontal edges. The shear preserves orientations and
+* the resulting vertex indices refer to the original
+* coordinates.
+***********************************************************/
+static constexpr double SHEAR = 1.0e-7;
+
+struct SweepPoint
+{
+  double x;
+  double y;
+};
+
+static inline double cross(const SweepPoint& o,
+                           const SweepPoint& a,
+                           const SweepPoint& b)
+{
+  return (a.x-o.x)*(b.y-o.y) - (a.y-o.y)*(b.x-o.x);
+}
+
+// True, if point a is processed before point b by the sweep
+static inline bool above(const SweepPoint& a, const SweepPoint& b)
+{
+  return a.y > b.y || (a.y == b.y && a.x < b.x);
+}
+
+/***********************************************************
+* Vertex types of the monotone partition
+***********************************************************/
+enum class VertexType { Start, End, Split, Merge, Regular };
+
+/***********************************************************
+* Domain boundary with the vertex links of all rings
+***********************************************************/
+struct Domain
+{
+  std::vector<SweepPoint> pts;
+  std::vector<int>        next;
+  std::vector<int>        prev;
+
+  // Add a ring with interior to its left
+  void add_ring(const std::vector<Vec2r>& ring, bool ccw)
+  {
+    int N = ring.size();
+    int offset = pts.size();
+
+    double area = 0.0;
+    for (int i = 0, j = N-1; i < N; j = i++)
+      area += double(ring[j][0]) * ring[i][1]
+            - double(ring[i][0]) * ring[j][1];
+
+    bool reverse = ccw ? (area < 0.0) : (area > 0.0);
+
+    for (int i = 0; i < N; ++i)
+    {
+      pts.push_back( { ring[i][0], ring[i][1] + SHEAR * ring[i][0] } );
+
+      int n = offset + (i+1) % N;
+      int p = offset + (i+N-1) % N;
+      next.push_back( reverse ? p : n );
+      prev.push_back( reverse ? n : p );
+    }
+  }
+};
+
+/***********************************************************
+* Ordering of the edges, that are cut by the sweep line.
+* Edge e runs from vertex e to vertex next[e]. The query
+* index refers to the vertex, which is currently processed.
+***********************************************************/
+struct EdgeOrder
+{
+  const Domain*     dom;
+  const SweepPoint* sweep;
+  int               query;
+
+  double x_at(int e, double y) const
+  {
+    if (e == query)
+      return sweep->x;
+
+    const SweepPoint& a = dom->pts[e];
+    const SweepPoint& b = dom->pts[dom->next[e]];
+    return a.x + (y - a.y) * (b.x - a.x) / (b.y - a.y);
+  }
+
+  bool operator()(int a, int b) const
+  {
+    double xa = x_at(a, sweep->y);
+    double xb = x_at(b, sweep->y);
+
+    if (xa != xb)
+      return xa < xb;
+
+    // Edges that start at the same vertex
+    return x_at(a, sweep->y - 1.0) < x_at(b, sweep->y - 1.0);
+  }
+};
+
+/***********************************************************
+* Partition the domain into y-monotone pieces.
+* Returns the diagonals, that have to be inserted.
+***********************************************************/
+static std::vector<std::pair<int,int>>
+monotone_diagonals(const Domain& dom)
+{
+  int N = dom.pts.size();
+  const auto& pts = dom.pts;
+
+  std::vector<int> order(N);
+  for (int i = 0; i < N; ++i)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), [&](int a, int b)
+  { return above(pts[a], pts[b]); });
+
+  std::vector<VertexType> type(N);
+  for (int i = 0; i < N; ++i)
+  {
+    const SweepPoint& v = pts[i];
+    const SweepPoint& p = pts[dom.prev[i]];
+    const SweepPoint& n = pts[dom.next[i]];
+    bool convex = cross(p, v, n) > 0.0;
+
+    if (above(v, p) && above(v, n))
+      type[i] = convex ? VertexType::Start : VertexType::Split;
+    else if (above(p, v) && above(n, v))
+      type[i] = convex ? VertexType::End : VertexType::Merge;
+    else
+      type[i] = VertexType::Regular;
+  }
+
+  SweepPoint sweep { 0.0, 0.0 };
+  EdgeOrder less { &dom, &sweep, N };
+  std::set<int, EdgeOrder> status(less);
+
+  std::vector<std::set<int, EdgeOrder>::iterator> entry(N, status.end());
+  std::vector<int> helper(N, -1);
+  std::vector<std::pair<int,int>> diagonals;
+
+  auto insert = [&](int e, int v)
+  {
+    entry[e] = status.insert(e).first;
+    helper[e] = v;
+  };
+
+  auto remove = [&](int e)
+  {
+    if (entry[e] != status.end())
+      status.erase(entry[e]);
+    entry[e] = status.end();
+  };
+
+  auto fix_merge = [&](int e, int v)
+  {
+    if (helper[e] >= 0 && type[helper[e]] == VertexType::Merge)
+      diagonals.push_back( { v, helper[e] } );
+  };
+
+  // Edge directly left of the current vertex
+  auto left_of = [&]() -> int
+  {
+    auto it = status.lower_bound(N);
+    if (it == status.begin())
+      return -1;
+    return *(--it);
+  };
+
+  for (int v : order)
+  {
+    sweep = pts[v];
+    int e_prev = dom.prev[v];
+
+    switch (type[v])
+    {
+      case VertexType::Start:
+        insert(v, v);
+        break;
+
+      case VertexType::End:
+        fix_merge(e_prev, v);
+        remove(e_prev);
+        break;
+
+      case VertexType::Split:
+      {
+        int e = left_of();
+        if (e >= 0)
+        {
+          diagonals.push_back( { v, helper[e] } );
+          helper[e] = v;
+        }
+        insert(v, v);
+        break;
+      }
+
+      case VertexType::Merge:
+      {
+        fix_merge(e_prev, v);
+        remove(e_prev);
+        int e = left_of();
+        if (e >= 0)
+        {
+          fix_merge(e, v);
+          helper[e] = v;
+        }
+        break;
+      }
+
+      case VertexType::Regular:
+        // Interior lies to the right of the vertex
+        if (above(pts[e_prev], pts[v]))
+        {
+          fix_merge(e_prev, v);
+          remove(e_prev);
+          insert(v, v);
+        }
+        else
+        {
+          int e = left_of();
+          if (e >= 0)
+          {
+            fix_merge(e, v);
+            helper[e] = v;
+          }
+        }
+        break;
+    }
+  }
+
+  // A diagonal may be found from both of its ends
+  for (auto& d : diagonals)
+    if (d.first > d.second)
+      std::swap(d.first, d.second);
+  std::sort(diagonals.begin(), diagonals.end());
+  diagonals.erase( std::unique(diagonals.begin(), diagonals.end()),
+                   diagonals.end() );
+
+  return diagonals;
+}
+
+/***********************************************************
+* Split the domain along the diagonals and return the
+* boundaries of the resulting faces, each oriented with
+* the interior to its left
+***********************************************************/
+static std::vector<std::vector<int>>
+monotone_faces(const Domain& dom,
+               const std::vector<std::pair<int,int>>& diagonals)
+{
+  int N = dom.pts.size();
+  const auto& pts = dom.pts;
+
+  // Outgoing half edges of every vertex
+  std::vector<std::vector<int>> out(N);
+  for (int i = 0; i < N; ++i)
+  {
+    out[i].push_back(dom.next[i]);
+    out[i].push_back(dom.prev[i]);
+  }
+  for (auto d : diagonals)
+  {
+    out[d.first].push_back(d.second);
+    out[d.second].push_back(d.first);
+  }
+
+  auto angle = [&](int a, int b)
+  { return std::atan2(pts[b].y - pts[a].y, pts[b].x - pts[a].x); };
+
+  // Sort counter-clockwise around every vertex
+  for (int i = 0; i < N; ++i)
+    if (out[i].size() > 2)
+      std::sort(out[i].begin(), out[i].end(), [&](int a, int b)
+      { return angle(i, a) < angle(i, b); });
+
+  std::vector<std::vector<char>> used(N);
+  for (int i = 0; i < N; ++i)
+    used[i].assign(out[i].size(), 0);
+
+  // Reverse half edges of the boundary lie outside
+  auto usable = [&](int v, int k)
+  {
+    int w = out[v][k];
+    return !used[v][k] && (dom.next[v] == w || dom.prev[v] != w);
+  };
+
+  std::vector<std::vector<int>> faces;
+
+  for (int s = 0; s < N; ++s)
+  {
+    for (int k = 0; k < out[s].size(); ++k)
+    {
+      if (!usable(s, k))
+        continue;
+
+      std::vector<int> face;
+      int u = s, ku = k;
+
+      while (!used[u][ku])
+      {
+        used[u][ku] = 1;
+        face.push_back(u);
+
+        // At vertex v, continue with the next edge clockwise
+        // of the reverse edge (v,u)
+        int v = out[u][ku];
+        int M = out[v].size();
+        int kr = 0;
+        while (out[v][kr] != u)
+          ++kr;
+
+        u  = v;
+        ku = (kr + M - 1) % M;
+      }
+
+      faces.push_back(face);
+    }
+  }
+
+  return faces;
+}
+
+/***********************************************************
+* Triangulate a y-monotone face in linear time
+***********************************************************/
+static void triangulate_monotone(const Domain& dom,
+                                 const std::vector<int>& face,
+                                 std::vector<std::array<int,3>>& tris)
+{
+  int N = face.size();
+  const auto& pts = dom.pts;
+
+  if (N < 3)
+    return;
+
+  if (N == 3)
+  {
+    tris.push_back( { face[0], face[1], face[2] } );
+    return;
+  }
+
+  int top = 0, bot = 0;
+  for (int i = 1; i < N; ++i)
+  {
+    if (above(pts[face[i]], pts[face[top]])) top = i;
+    if (above(pts[face[bot]], pts[face[i]])) bot = i;
+  }
+
+  // Merge both chains in sweep order. The chain from the top
+  // in face direction is the left chain.
+  std::vector<int>  u;
+  std::vector<bool> left;
+  u.reserve(N);
+  left.reserve(N);
+
+  int l = top, r = top;
+  u.push_back(face[top]);
+  left.push_back(true);
+
+  l = (l+1) % N;
+  r = (r+N-1) % N;
+
+  while (u.size() < N)
+  {
+    bool take_left = (r == bot) ||
+      (l != bot && above(pts[face[l]], pts[face[r]]));
+
+    if (take_left && l != bot)
+    {
+      u.push_back(face[l]);
+      left.push_back(true);
+      l = (l+1) % N;
+    }
+    else if (r != bot)
+    {
+      u.push_back(face[r]);
+      left.push_back(false);
+      r = (r+N-1) % N;
+    }
+    else
+    {
+      u.push_back(face[bot]);
+      left.push_back(false);
+    }
+  }
+
+  auto add = [&](int a, int b, int c)
+  {
+    if (cross(pts[a], pts[b], pts[c]) < 0.0)
+      std::swap(b, c);
+    tris.push_back( { a, b, c } );
+  };
+
+  std::vector<int> stack { 0, 1 };
+
+  for (int j = 2; j < N-1; ++j)
+  {
+    if (left[j] != left[stack.back()])
+    {
+      // Connect to all vertices of the opposite chain
+      for (int k = stack.size()-1; k > 0; --k)
+        add(u[j], u[stack[k]], u[stack[k-1]]);
+
+      int last = stack.back();
+      stack.clear();
+      stack.push_back(last);
+      stack.push_back(j);
+    }
+    else
+    {
+      int last = stack.back();
+      stack.pop_back();
+
+      while (!stack.empty())
+      {
+        int c = stack.back();
+        double o = left[j]
+          ? cross(pts[u[c]], pts[u[last]], pts[u[j]])
+          : cross(pts[u[j]], pts[u[last]], pts[u[c]]);
+
+        if (o <= 0.0)
+          break;
+
+        add(u[j], u[last], u[c]);
+        last = c;
+        stack.pop_back();
+      }
+
+      stack.push_back(last);
+      stack.push_back(j);
+    }
+  }
+
+  // Connect the bottom vertex to the remaining stack
+  for (int k = stack.size()-1; k > 0; --k)
+    add(u[N-1], u[stack[k]], u[stack[k-1]]);
+}
+
+/***********************************************************
+* Function to triangulate a polygon with holes
+***********************************************************/
+Triangulation triangulate(const std::vector<Vec2r>& outline,
+                          const std::vector<std::vector<Vec2r>>& holes)
+{
+  TRACE_ZONE("triangulate");
+
+  Triangulation result;
+
+  if (outline.size() < 3)
+    return result;
+
+  Domain dom;
+  dom.add_ring(outline, true);
+  result.vertices = outline;
+
+  for (const auto& h : holes)
+  {
+    if (h.size() < 3)
+      continue;
+    dom.add_ring(h, false);
+    result.vertices.insert(result.vertices.end(), h.begin(), h.end());
+  }
+
+  std::vector<std::pair<int,int>> diagonals = monotone_diagonals(dom);
+
+  result.triangles.reserve(dom.pts.size() + 2 * holes.size());
+
+  for (const auto& face : monotone_faces(dom, diagonals))
+    triangulate_monotone(dom, face, result.triangles);
+
+  return result;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "Vec2.h"
+
+/***********************************************************
+* Triangulation of a polygonal domain
+* The vertices hold the outline followed by all holes,
+* triangles refer to the vertex indices and have a
+* positive signed area.
+***********************************************************/
+struct Triangulation
+{
+  std::vector<Vec2r>              vertices;
+  std::vector<std::array<int,3>>  triangles;
+};
+
+/***********************************************************
+* Function to triangulate a simple polygon with optional
+* holes in O(n log n).
+* The domain is first partitioned into y-monotone pieces
+* by a plane sweep, which are then triangulated in linear
+* time each. Outline and holes may be given in any
+* orientation, but must not intersect each other.
+***********************************************************/
+Triangulation triangulate(const std::vector<Vec2r>& outline,
+                          const std::vector<std::vector<Vec2r>>& holes
+                            = {});
@@ -0,0 +1,393 @@
+#include "Validator.h"
+#include "Convex.h"
+#include "ModelSpace.h"
+#include "Shape.h"
+#include "TaskPool.h"
+#include "Trace.h"
+#include "Vec2.h"
+
+#include <algorithm>
+
+/***********************************************************
+* Axis aligned bounding box of a shape, which is taken from
+* its cached properties
+***********************************************************/
+struct BBox
+{
+  Vec2r lo;
+  Vec2r hi;
+};
+
+static BBox bounding_box(Shape* s)
+{
+  BBox b;
+  s->bounding_box(b.lo, b.hi);
+  return b;
+}
+
+template <typename V>
+static inline bool bbox_overlap(const V& a_lo, const V& a_hi,
+                                const V& b_lo, const V& b_hi)
+{
+  return a_lo[0] <= b_hi[0] && b_lo[0] <= a_hi[0]
+      && a_lo[1] <= b_hi[1] && b_lo[1] <= a_hi[1];
+}
+
+/***********************************************************
+* Function to check if point p lies inside of a shape
+* (crossing number test, also for concave shapes)
+***********************************************************/
+static bool inside(Shape* s, const Vec2r& p)
+{
+  int N = s->number_of_nodes();
+  bool in = false;
+
+  for (int i = 0, j = N-1; i < N; j = i++)
+  {
+    Vec2r a = s->get_node(i)->coords();
+    Vec2r b = s->get_node(j)->coords();
+
+    if ( (a[1] > p[1]) != (b[1] > p[1]) &&
+         p[0] < (b[0]-a[0]) * (p[1]-a[1]) / (b[1]-a[1]) + a[0] )
+      in = !in;
+  }
+
+  return in;
+}
+
+/***********************************************************
+* Interior of a shape around a point c on its boundary. It
+* lies left of the ray from c towards next and right of 
+* the ray towards prev. On an edge, both rays run along it.
+***********************************************************/
+template <typename V>
+struct Sector
+{
+  V c;
+  V next;
+  V prev;
+};
+
+/*----------------------------------------------------------
+| True, if the ray from c towards d lies strictly within
+| the sector
+----------------------------------------------------------*/
+template <typename V>
+static bool in_sector(const Sector<V>& s, const V& d)
+{
+  bool after  = is_left(s.c, s.next, d);
+  bool before = is_left(s.c, d, s.prev);
+
+  // Convex sectors are the intersection of both sides
+  if (is_lefton(s.c, s.next, s.prev))
+    return after && before;
+
+  return after || before;
+}
+
+/*----------------------------------------------------------
+| True, if the rays from c towards p and q point in the
+| same direction
+----------------------------------------------------------*/
+template <typename V>
+static bool same_ray(const V& c, const V& p, const V& q)
+{
+  if (orientation(c, p, q) != Orient::CL)
+    return false;
+
+  V u = p - c;
+  V v = q - c;
+
+  return (u[0] > 0) == (v[0] > 0) && (u[0] < 0) == (v[0] < 0)
+      && (u[1] > 0) == (v[1] > 0) && (u[1] < 0) == (v[1] < 0);
+}
+
+/*----------------------------------------------------------
+| True, if two sectors around the same point overlap. This
+| is the case, if a ray of one lies within the other, or 
+| if both continue from the same ray to the same side.
+----------------------------------------------------------*/
+template <typename V>
+static bool sectors_overlap(const Sector<V>& a, const Sector<V>& b)
+{
+  return in_sector(a, b.next) || in_sector(a, b.prev)
+      || in_sector(b, a.next) || in_sector(b, a.prev)
+      || same_ray(a.c, a.next, b.next)
+      || same_ray(a.c, a.prev, b.prev);
+}
+
+/*----------------------------------------------------------
+| Sector of the closed polygon c around the point x on its
+| edge i, which is either a node of the edge or lies 
+| within it. For reversed polygons, the interior lies
+| right of the edges.
+----------------------------------------------------------*/
+template <typename V>
+static Sector<V> sector(const std::vector<V>& c, int i, 
+                        const V& x, bool reversed)
+{
+  int N = c.size();
+  Sector<V> s { x, c[(i+1)%N], c[i] };
+
+  if (x == c[i])
+    s.prev = c[(i+N-1)%N];
+  else if (x == c[(i+1)%N])
+  {
+    s.prev = c[i];
+    s.next = c[(i+2)%N];
+  }
+
+  if (reversed)
+    std::swap(s.next, s.prev);
+
+  return s;
+}
+
+/*----------------------------------------------------------
+| True, if the segments (p,q) and (r,s) cross each other at
+| a single point within both of them
+----------------------------------------------------------*/
+template <typename V>
+static bool edges_cross(const V& p, const V& q, 
+                        const V& r, const V& s)
+{
+  Orient o1 = orientation(p, q, r);
+  Orient o2 = orientation(p, q, s);
+  Orient o3 = orientation(r, s, p);
+  Orient o4 = orientation(r, s, q);
+
+  return o1 != Orient::CL && o2 != Orient::CL && o1 != o2
+      && o3 != Orient::CL && o4 != Orient::CL && o3 != o4;
+}
+
+/***********************************************************
+* Function to search for overlapping edges of the closed
+* polygons a and b, on floating point or fixed-point 
+* coordinates. Edges of a outside of the box (b_lo,b_hi) 
+* are skipped.
+*
+* Edges overlap, if they cross each other, or if they 
+* touch at a point, around which the interiors of both
+* polygons overlap. Touching from outside, along entire or
+* partial edges or at single nodes, is no overlap. Returns
+* in contact, if the polygons touch anywhere.
+***********************************************************/
+template <typename V>
+static bool edges_overlap(const std::vector<V>& a, bool a_reversed,
+                          const std::vector<V>& b, bool b_reversed,
+                          const V& b_lo, const V& b_hi,
+                          int& i_edge, int& j_edge, bool& contact)
+{
+  int Na = a.size();
+  int Nb = b.size();
+
+  for (int i = 0; i < Na; ++i)
+  {
+    const V& p = a[i];
+    const V& q = a[(i+1)%Na];
+    V e_lo = bbox_min(p, q);
+    V e_hi = bbox_max(p, q);
+
+    if (!bbox_overlap(e_lo, e_hi, b_lo, b_hi))
+      continue;
+
+    for (int j = 0; j < Nb; ++j)
+    {
+      const V& r = b[j];
+      const V& s = b[(j+1)%Nb];
+
+      if (!bbox_overlap(e_lo, e_hi, bbox_min(r, s), bbox_max(r, s)))
+        continue;
+
+      bool overlap = edges_cross(p, q, r, s);
+
+      // Nodes of one edge on the other one
+      for (const V* x : { &p, &q, &r, &s })
+      {
+        if (overlap)
+          break;
+
+        if ( !in_on_segment(p, q, *x) || !in_on_segment(r, s, *x) )
+          continue;
+
+        contact = true;
+        overlap = sectors_overlap(sector(a, i, *x, a_reversed),
+                                  sector(b, j, *x, b_reversed));
+      }
+
+      if (overlap)
+      {
+        i_edge = i;
+        j_edge = j;
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+/***********************************************************
+* Narrow phase: check if the interiors of two shapes 
+* overlap. On overlapping edges, i_edge and j_edge are set
+* to their start nodes, otherwise to -1. Shapes, whose 
+* convex hulls are apart, are skipped. Shapes on the 
+* fixed-point grid are checked exactly. Their fixed-point 
+* nodes have been computed during the check for 
+* self-intersections and their hulls along with their 
+* bounding boxes and orientations, such that this is safe
+* to call concurrently.
+***********************************************************/
+static bool overlap(Shape* a, bool a_reversed,
+                    Shape* b, bool b_reversed, const BBox& bb,
+                    int& i_edge, int& j_edge)
+{
+  i_edge = -1;
+  j_edge = -1;
+
+  if (convex_apart(a->convex_hull(), b->convex_hull()))
+    return false;
+
+  const std::vector<Vec2l>* fa = a->fixed_nodes();
+  const std::vector<Vec2l>* fb = b->fixed_nodes();
+  bool contact = false;
+
+  if (fa && fb)
+  {
+    Vec2l b_lo, b_hi;
+    to_fixed(bb.lo, b_lo);
+    to_fixed(bb.hi, b_hi);
+
+    if (edges_overlap(*fa, a_reversed, *fb, b_reversed, 
+                      b_lo, b_hi, i_edge, j_edge, contact))
+      return true;
+  }
+  else if (edges_overlap(a->coords(), a_reversed, 
+                         b->coords(), b_reversed,
+                         bb.lo, bb.hi, i_edge, j_edge, contact))
+    return true;
+
+  // Touching shapes would contain each other at a contact
+  if (contact)
+    return false;
+
+  // Boundaries apart -> check if one contains the other
+  return inside(b, a->get_node(0)->coords())
+      || inside(a, b->get_node(0)->coords());
+}
+
+/***********************************************************
+* Function to validate all shapes of a model space
+***********************************************************/
+std::vector<ValidationIssue> validate_model(ModelSpace& space)
+{
+  TRACE_ZONE("validate_model");
+
+  TaskPool& pool = TaskPool::instance();
+  std::vector<ValidationIssue> issues;
+
+  /*--------------------------------------------------------
+  | Check every shape for self-intersections
+  --------------------------------------------------------*/
+  for (auto shapes : {&space.extr_shapes(), &space.intr_shapes()})
+  {
+    int N = shapes->size();
+    std::vector<ValidationIssue> found(N);
+    std::vector<char> invalid(N, 0);
+
+    pool.parallel_for(0, N, [&](int k)
+    {
+      Shape* s = (*shapes)[k];
+      int i = -1, j = -1;
+
+      if (s->valid())
+        return;
+
+      s->self_intersection(i, j);
+      invalid[k] = 1;
+      found[k] = { ValidationIssue::Type::SelfIntersection,
+                   s->exterior(), k, i, k, j };
+    }, 64);
+
+    for (int k = 0; k < N; ++k)
+      if (invalid[k])
+        issues.push_back(found[k]);
+  }
+
+  /*--------------------------------------------------------
+  | Broad phase: sort and sweep the bounding boxes of all
+  | exterior shapes along the x-axis
+  --------------------------------------------------------*/
+  std::vector<Shape*>& shapes = space.extr_shapes();
+  int N = shapes.size();
+
+  std::vector<BBox> boxes(N);
+  std::vector<char> reversed(N, 0);
+  pool.parallel_for(0, N, [&](int k)
+  {
+    if (shapes[k]->number_of_nodes() > 0)
+    {
+      boxes[k] = bounding_box(shapes[k]);
+      reversed[k] = (shapes[k]->orientation() == Orient::CW);
+      shapes[k]->convex_hull();
+    }
+  }, 256);
+
+  std::vector<int> order(N);
+  for (int k = 0; k < N; ++k)
+    order[k] = k;
+  std::sort(order.begin(), order.end(), [&](int a, int b)
+  { return boxes[a].lo[0] < boxes[b].lo[0]; });
+
+  std::vector<std::pair<int,int>> candidates;
+  std::vector<int> active;
+
+  for (int k : order)
+  {
+    if (shapes[k]->number_of_nodes() < 3)
+      continue;
+
+    const BBox& b = boxes[k];
+
+    // Remove boxes that end before the current one starts
+    active.erase( std::remove_if(active.begin(), active.end(),
+                  [&](int a) { return boxes[a].hi[0] < b.lo[0]; }),
+                  active.end() );
+
+    for (int a : active)
+      if (boxes[a].lo[1] <= b.hi[1] && b.lo[1] <= boxes[a].hi[1])
+        candidates.push_back( { minimum(a, k), maximum(a, k) } );
+
+    active.push_back(k);
+  }
+
+  // Report overlaps in a deterministic order
+  std::sort(candidates.begin(), candidates.end());
+
+  /*--------------------------------------------------------
+  | Narrow phase: test the candidate pairs in parallel
+  --------------------------------------------------------*/
+  int Nc = candidates.size();
+  std::vector<ValidationIssue> found(Nc);
+  std::vector<char> overlapping(Nc, 0);
+
+  pool.parallel_for(0, Nc, [&](int c)
+  {
+    int a = candidates[c].first;
+    int b = candidates[c].second;
+    int i, j;
+
+    if (overlap(shapes[a], reversed[a], shapes[b], reversed[b], 
+                boxes[b], i, j))
+    {
+      overlapping[c] = 1;
+      found[c] = { ValidationIssue::Type::Overlap, true, a, i, b, j };
+    }
+  }, 16);
+
+  for (int c = 0; c < Nc; ++c)
+    if (overlapping[c])
+      issues.push_back(found[c]);
+
+  return issues;
+}
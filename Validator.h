@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+class ModelSpace;
+
+/***********************************************************
+* A problem found by the document validation
+***********************************************************/
+struct ValidationIssue
+{
+  enum class Type {
+    SelfIntersection,   // Edges of shape_a intersect
+    Overlap             // Exterior shapes a and b overlap
+  };
+
+  Type type;
+  bool exterior;
+
+  // Shape indices and start nodes of the conflicting edges
+  // node_a / node_b = -1, if one shape contains the other
+  int  shape_a;
+  int  node_a;
+  int  shape_b;
+  int  node_b;
+};
+
+/***********************************************************
+* Function to validate all shapes of a model space.
+*
+* * Every shape is checked for self-intersections
+* * Exterior shapes are checked for overlaps among each
+*   other: candidate pairs are found by sorting and
+*   sweeping their bounding boxes. Pairs with separate
+*   convex hulls are dropped, the others are followed by
+*   tests of their edges and a containment test. Shapes,
+*   which only touch each other from outside, do not 
+*   overlap.
+*
+* Both steps run in parallel on the shared task pool.
+***********************************************************/
+std::vector<ValidationIssue> validate_model(ModelSpace& space);
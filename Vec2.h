@@ -1,5 +1,6 @@
 #pragma once
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 
 /***********************************************************
@@ -10,6 +11,8 @@ class Vec2
 {
 
 public:
+  using value_type = T;
+
   T e[2];
 
   // Construct
@@ -17,10 +20,12 @@ public:
   Vec2(T e0, T e1) : e{e0,e1} {}
   // Copy 
   Vec2(const Vec2<T>& v) : e{v[0],v[1]} {}
-  Vec2<T>& operator=(const Vec2<T>& v) { e[0]=v[0]; e[1]=v[1]; }
+  Vec2<T>& operator=(const Vec2<T>& v) 
+  { e[0]=v[0]; e[1]=v[1]; return *this; }
   // Move
   Vec2(Vec2<T>&& v) : e{v[0],v[1]} {}
-  Vec2<T>& operator=(Vec2<T>&& v) { e[0]=v[0]; e[1]=v[1]; }
+  Vec2<T>& operator=(Vec2<T>&& v) 
+  { e[0]=v[0]; e[1]=v[1]; return *this; }
 
   // Vector access
   T x() const { return e[0]; }
@@ -170,25 +175,29 @@ inline Vec2<T> operator/(const Vec2<T> &u,const Vec2<T> &v)
 
 // Vector-scalar addition
 template <typename T>
-inline Vec2<T> operator+(const Vec2<T> &u, const T v)
+inline Vec2<T> operator+(const Vec2<T> &u, 
+                          const typename Vec2<T>::value_type v)
 {
   return Vec2<T>(u.e[0]+v, u.e[1]+v);
 }
 // Vector-scalar substraction
 template <typename T>
-inline Vec2<T> operator-(const Vec2<T> &u, const T v)
+inline Vec2<T> operator-(const Vec2<T> &u, 
+                          const typename Vec2<T>::value_type v)
 {
   return Vec2<T>(u.e[0]-v, u.e[1]-v);
 }
 // Vector-scalar multiplication
 template <typename T>
-inline Vec2<T> operator*(const Vec2<T> &u, const T v)
+inline Vec2<T> operator*(const Vec2<T> &u, 
+                          const typename Vec2<T>::value_type v)
 {
   return Vec2<T>(u.e[0]*v, u.e[1]*v);
 }
 // Vector-scalar division
 template <typename T>
-inline Vec2<T> operator/(const Vec2<T> &u, const T v)
+inline Vec2<T> operator/(const Vec2<T> &u, 
+                          const typename Vec2<T>::value_type v)
 {
   return Vec2<T>(u.e[0]/v, u.e[1]/v);
 }
@@ -218,9 +227,25 @@ inline Vec2<T> unit_vector(const Vec2<T>& u)
 * integer / double vector aliases
 ***********************************************************/
 using Vec2i = Vec2<int>;
+using Vec2l = Vec2<int64_t>;
 using Vec2d = Vec2<double>;
 using Vec2f = Vec2<float>;
 
+/***********************************************************
+* Scalar of the model coordinates. Builds with 
+* PIXMODELER_DOUBLE keep their precision far from the 
+* origin and for large layouts in small units. Screen
+* coordinates are always computed relative to the view 
+* and stay in single precision.
+***********************************************************/
+#ifdef PIXMODELER_DOUBLE
+using Real = double;
+#else
+using Real = float;
+#endif
+
+using Vec2r = Vec2<Real>;
+
 
 /***********************************************************
 * Vec2 geometry functions
@@ -342,6 +367,85 @@ static inline bool in_on_segment(const Vec2<T>& p,
   return false;
 }
 
+/***********************************************************
+* Fixed-point coordinates
+*
+* Coordinates, which are multiples of 1 / fixed_resolution,
+* like all nodes placed on the grid, are represented 
+* exactly by 64-bit integers. Their magnitude is limited 
+* to fixed_limit, such that the cross products of the 
+* predicates below never overflow. The predicates are 
+* thus exact and need no tolerance.
+***********************************************************/
+static constexpr int64_t fixed_resolution = 256;
+static constexpr int64_t fixed_limit      = int64_t(1) << 30;
+
+/*----------------------------------------------------------
+| Convert v into fixed-point coordinates f. Returns false, 
+| if v is not a multiple of the resolution or too large.
+----------------------------------------------------------*/
+template <typename T>
+static inline bool to_fixed(const Vec2<T>& v, Vec2l& f)
+{
+  double x = double(v[0]) * fixed_resolution;
+  double y = double(v[1]) * fixed_resolution;
+
+  if ( !(std::fabs(x) < fixed_limit && std::fabs(y) < fixed_limit) )
+    return false;
+
+  if ( x != std::floor(x) || y != std::floor(y) )
+    return false;
+
+  f = Vec2l { int64_t(x), int64_t(y) };
+  return true;
+}
+
+/*----------------------------------------------------------
+| Exact orientation of three fixed-point coordinates
+----------------------------------------------------------*/
+static inline Orient orientation(const Vec2l& p,
+                                 const Vec2l& q,
+                                 const Vec2l& r)
+{
+  int64_t area2 = (p[0]-r[0]) * (q[1]-r[1]) 
+                - (q[0]-r[0]) * (p[1]-r[1]);
+
+  if (area2 > 0)
+    return Orient::CW;
+  if (area2 < 0)
+    return Orient::CCW;
+  return Orient::CL;
+}
+
+/*----------------------------------------------------------
+| Exact check if r lies strictly within segment (p,q)
+----------------------------------------------------------*/
+static inline bool in_segment(const Vec2l& p,
+                              const Vec2l& q,
+                              const Vec2l& r)
+{
+  if (orientation(p,q,r) != Orient::CL)
+    return false;
+
+  int64_t t = dot(r-p, q-p);
+  return t > 0 && t < dot(q-p, q-p);
+}
+
+/*----------------------------------------------------------
+| Exact check if r lies within segment (p,q) or on its 
+| endings
+----------------------------------------------------------*/
+static inline bool in_on_segment(const Vec2l& p,
+                                 const Vec2l& q,
+                                 const Vec2l& r)
+{
+  if (orientation(p,q,r) != Orient::CL)
+    return false;
+
+  int64_t t = dot(r-p, q-p);
+  return t >= 0 && t <= dot(q-p, q-p);
+}
+
 /*----------------------------------------------------------
 | Check if two lines (p1,q1) and (p2,q2) intersect
 | 
@@ -357,6 +461,15 @@ static inline bool line_intersection(const Vec2<T>& p1,
                                      const Vec2<T>& p2,
                                      const Vec2<T>& q2)
 {
+  // Disjoint bounding boxes rule out an intersection, which
+  // the orientations of tiny, nearly collinear segments far
+  // apart from each other could report otherwise
+  if ( maximum(p1[0], q1[0]) < minimum(p2[0], q2[0]) ||
+       maximum(p2[0], q2[0]) < minimum(p1[0], q1[0]) ||
+       maximum(p1[1], q1[1]) < minimum(p2[1], q2[1]) ||
+       maximum(p2[1], q2[1]) < minimum(p1[1], q1[1]) )
+    return false;
+
   Orient o1 = orientation(p1, q1, p2);
   Orient o2 = orientation(p1, q1, q2);
   Orient o3 = orientation(p2, q2, p1);
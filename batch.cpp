@@ -0,0 +1,334 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <limits>
+#define OLC_PGE_APPLICATION
+#include "ModelSpace.h"
+#include "Trace.h"
+#include "Simplify.h"
+#include "TaskPool.h"
+#include "Validator.h"
+
+namespace fs = std::filesystem;
+
+/***********************************************************
+* Headless batch processing of model files.
+* The model spaces created here are never started as
+* PixelGameEngine windows, so neither the platform nor the
+* renderer is initialized and no display is required.
+* Images are rendered offscreen into sprites.
+***********************************************************/
+
+/***********************************************************
+* Batch operations, applied in the given order
+***********************************************************/
+enum class BatchOp {
+  Merge,
+  Simplify,
+  Validate,
+  Render
+};
+
+struct BatchCommand
+{
+  BatchOp op;
+  int     a = -1;
+  int     b = -1;
+  Real    tolerance = 0.0f;
+};
+
+/***********************************************************
+* Print usage information
+***********************************************************/
+static void print_usage()
+{
+  std::cout
+    << "Usage: cad_tool_batch [options] <model files>\n"
+    << "  -m, --merge <a> <b>   Merge exterior shapes a and b\n"
+    << "  -s, --simplify <tol>  Remove nodes deviating less than\n"
+    << "                        tol from the simplified shapes\n"
+    << "  -v, --validate        Check shapes for intersections\n"
+    << "                        and overlaps\n"
+    << "  -r, --render <w> <h>  Render the model to <output>.png\n"
+    << "  -o, --output <dir>    Output directory\n"
+    << "                        (default: <file>.out next to input)\n"
+    << "  -j, --jobs <n>        Number of worker threads\n"
+    << "                        (default: number of cores)\n"
+#ifdef PIXMODELER_TRACE
+    << "  -t, --trace <file>    Write a Chrome trace of the run\n"
+#endif
+    ;
+}
+
+/***********************************************************
+* Apply all commands to a single model file.
+* Returns false if the file could not be processed or
+* contains invalid shapes.
+***********************************************************/
+static bool process_file(ModelSpace& space,
+                         const std::string& file,
+                         const std::string& out_file,
+                         const std::vector<BatchCommand>& cmds,
+                         std::ostringstream& log)
+{
+  if (!space.load(file))
+  {
+    log << file << ": failed to load model\n";
+    return false;
+  }
+
+  bool success = true;
+  std::vector<Shape*>& shapes = space.extr_shapes();
+  int n_shapes = shapes.size();
+
+  for (const auto& cmd : cmds)
+  {
+    if (cmd.op == BatchOp::Validate)
+    {
+      for (const auto& issue : validate_model(space))
+      {
+        const char* type = issue.exterior ? "exterior" : "interior";
+
+        if (issue.type == ValidationIssue::Type::SelfIntersection)
+          log << file << ": " << type << " shape " << issue.shape_a
+              << " intersects itself at edges " << issue.node_a
+              << " and " << issue.node_b << "\n";
+        else if (issue.node_a < 0)
+          log << file << ": " << type << " shapes " << issue.shape_a
+              << " and " << issue.shape_b << " are nested\n";
+        else
+          log << file << ": " << type << " shapes " << issue.shape_a
+              << " and " << issue.shape_b << " overlap at edges "
+              << issue.node_a << " and " << issue.node_b << "\n";
+
+        success = false;
+      }
+      continue;
+    }
+
+    if (cmd.op == BatchOp::Simplify)
+    {
+      int n_removed = simplify_model(space, cmd.tolerance);
+      log << file << ": simplified, " << n_removed 
+          << " nodes removed\n";
+      continue;
+    }
+
+    if (cmd.op == BatchOp::Render)
+    {
+      std::string png_file = out_file + ".png";
+      if (!space.render_to_png(png_file, cmd.a, cmd.b))
+      {
+        log << png_file << ": failed to write image\n";
+        success = false;
+      }
+      continue;
+    }
+
+    if ( cmd.a < 0 || cmd.a >= n_shapes ||
+         cmd.b < 0 || cmd.b >= n_shapes )
+    {
+      log << file << ": shape index out of range\n";
+      success = false;
+      continue;
+    }
+
+    if (cmd.op == BatchOp::Merge)
+    {
+      Shape* new_shape = shapes[cmd.a]->merge(shapes[cmd.b]);
+      if (new_shape)
+        space.add_shape(new_shape);
+      else
+        log << file << ": shapes " << cmd.a << " and "
+            << cmd.b << " could not be merged\n";
+    }
+  }
+
+  if (!space.save(out_file))
+  {
+    log << out_file << ": failed to write model\n";
+    return false;
+  }
+
+  log << file << " -> " << out_file << "\n";
+
+  return success;
+}
+
+/***********************************************************
+* Functions to parse numeric arguments, which must consist
+* of the number only
+***********************************************************/
+static bool parse(const char* arg, int& value)
+{
+  char* end = nullptr;
+  errno = 0;
+  long v = std::strtol(arg, &end, 10);
+
+  if (end == arg || *end != '\0' || errno == ERANGE ||
+      v < std::numeric_limits<int>::min() ||
+      v > std::numeric_limits<int>::max())
+    return false;
+
+  value = int(v);
+  return true;
+}
+
+static bool parse(const char* arg, Real& value)
+{
+  char* end = nullptr;
+  errno = 0;
+  double v = std::strtod(arg, &end);
+
+  if (end == arg || *end != '\0' || errno == ERANGE)
+    return false;
+
+  value = Real(v);
+  return true;
+}
+
+/***********************************************************
+* Main
+***********************************************************/
+int main(int argc, char* argv[])
+{
+  std::vector<BatchCommand> cmds;
+  std::vector<std::string> files;
+  std::string out_dir;
+  std::string trace_file;
+  int n_jobs = 0;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+
+    bool parsed = true;
+
+    if ((arg == "-m" || arg == "--merge") && i+2 < argc)
+    {
+      BatchCommand cmd { BatchOp::Merge };
+      parsed = parse(argv[++i], cmd.a) && parse(argv[++i], cmd.b);
+      cmds.push_back(cmd);
+    }
+    else if (arg == "-c" || arg == "--clip")
+    {
+      // Shape::clip() does not create any shapes yet
+      std::cerr << "Clipping is not supported yet\n";
+      return 1;
+    }
+    else if ((arg == "-r" || arg == "--render") && i+2 < argc)
+    {
+      BatchCommand cmd { BatchOp::Render };
+      parsed = parse(argv[++i], cmd.a) && parse(argv[++i], cmd.b);
+      if (parsed && (cmd.a <= 0 || cmd.b <= 0))
+      {
+        std::cerr << "Invalid image size\n";
+        return 1;
+      }
+      cmds.push_back(cmd);
+    }
+    else if ((arg == "-s" || arg == "--simplify") && i+1 < argc)
+    {
+      BatchCommand cmd { BatchOp::Simplify };
+      parsed = parse(argv[++i], cmd.tolerance);
+      if (parsed && !(cmd.tolerance >= 0.0f))
+      {
+        std::cerr << "Invalid tolerance\n";
+        return 1;
+      }
+      cmds.push_back(cmd);
+    }
+    else if (arg == "-v" || arg == "--validate")
+      cmds.push_back( { BatchOp::Validate } );
+    else if ((arg == "-o" || arg == "--output") && i+1 < argc)
+      out_dir = argv[++i];
+    else if ((arg == "-j" || arg == "--jobs") && i+1 < argc)
+      parsed = parse(argv[++i], n_jobs);
+    else if ((arg == "-t" || arg == "--trace") && i+1 < argc)
+      trace_file = argv[++i];
+    else if (arg == "-h" || arg == "--help")
+    {
+      print_usage();
+      return 0;
+    }
+    else if (arg[0] == '-')
+    {
+      std::cerr << "Unknown option: " << arg << "\n";
+      print_usage();
+      return 1;
+    }
+    else
+      files.push_back(arg);
+
+    if (!parsed)
+    {
+      std::cerr << "Invalid argument for " << arg << "\n";
+      print_usage();
+      return 1;
+    }
+  }
+
+  if (files.empty())
+  {
+    print_usage();
+    return 1;
+  }
+
+  if (!out_dir.empty())
+    fs::create_directories(out_dir);
+
+  /*--------------------------------------------------------
+  | Process files in parallel on the task pool.
+  | The PixelGameEngine base constructor sets up shared
+  | static state, so model spaces are created one at a time.
+  --------------------------------------------------------*/
+  TaskPool::configure(n_jobs);
+
+  std::atomic<bool> all_success { true };
+  std::mutex        create_mutex;
+  std::mutex        log_mutex;
+
+  TaskPool::instance().parallel_for(0, files.size(), [&](int i)
+  {
+    TRACE_ZONE("process_file");
+
+    std::string out_file = files[i] + ".out";
+    if (!out_dir.empty())
+      out_file = (fs::path(out_dir)
+               / fs::path(files[i]).filename()).string();
+
+    ModelSpace* space = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(create_mutex);
+      space = new ModelSpace();
+    }
+
+    std::ostringstream log;
+    if (!process_file(*space, files[i], out_file, cmds, log))
+      all_success = false;
+
+    {
+      std::lock_guard<std::mutex> lock(create_mutex);
+      delete space;
+    }
+
+    std::lock_guard<std::mutex> lock(log_mutex);
+    std::cout << log.str();
+  });
+
+#ifdef PIXMODELER_TRACE
+  if (!trace_file.empty() && !trace::write(trace_file))
+  {
+    std::cerr << trace_file << ": failed to write trace\n";
+    all_success = false;
+  }
+#endif
+
+  return all_success ? 0 : 1;
+}
@@ -0,0 +1,574 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <cmath>
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
+#define OLC_PGE_APPLICATION
+#include "ModelSpace.h"
+#include "Polygon.h"
+#include "Triangulation.h"
+#include "Convex.h"
+#include "Mesh.h"
+#include "SizeField.h"
+#include "Snap.h"
+#include "Rasterizer.h"
+#include "Span.h"
+
+/***********************************************************
+* Micro-benchmarks for the geometry kernels.
+* Every kernel is timed for growing input sizes until a
+* single call exceeds the time limit. The output lists the
+* time per operation and the scaling exponent between
+* successive sizes.
+*
+* Usage: cad_tool_bench [kernel filter] [max size]
+***********************************************************/
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr double min_time  = 0.2;   // [s] per measurement
+static constexpr double max_call  = 2.0;   // [s] per single call
+static constexpr unsigned seed    = 12345;
+
+// Prevents the compiler from optimizing results away
+static volatile long long sink = 0;
+
+/***********************************************************
+* A polygon that can be filled directly with a list of
+* coordinates. Shape::add_node() checks every new edge
+* against all others, which would make the setup of large
+* inputs quadratic.
+***********************************************************/
+class BenchPolygon : public Polygon
+{
+public:
+  BenchPolygon(ModelSpace& space, const std::vector<Vec2r>& c)
+  : Polygon(space, 0, true)
+  {
+    for (int i = 0; i < c.size(); ++i)
+      nodes_.push_back( new Node {*this, i, c[i]} );
+    complete_ = true;
+    set_orientation(Orient::CCW);
+  }
+};
+
+/***********************************************************
+* Input polygon generators
+***********************************************************/
+static constexpr float pi = 3.14159265358979f;
+
+// Star-shaped polygon with random radii
+static std::vector<Vec2r> random_polygon(int n)
+{
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> radius(0.5f, 1.0f);
+  std::vector<Vec2r> c;
+  float R = 0.1f * n;
+  for (int i = 0; i < n; ++i)
+  {
+    float phi = 2.0f * pi * i / n;
+    float r = R * radius(gen);
+    c.push_back( { r*cosf(phi), r*sinf(phi) } );
+  }
+  return c;
+}
+
+// Star with alternating spikes
+static std::vector<Vec2r> star_polygon(int n)
+{
+  std::vector<Vec2r> c;
+  float R = 0.1f * n;
+  for (int i = 0; i < n; ++i)
+  {
+    float phi = 2.0f * pi * i / n;
+    float r = (i % 2) ? 0.3f * R : R;
+    c.push_back( { r*cosf(phi), r*sinf(phi) } );
+  }
+  return c;
+}
+
+// Comb with n/4 long, narrow teeth
+static std::vector<Vec2r> comb_polygon(int n)
+{
+  std::vector<Vec2r> c;
+  int teeth = maximum(1, (n-2) / 4);
+  for (int i = 0; i < teeth; ++i)
+  {
+    float x = 2.0f * i;
+    c.push_back( { x,        0.0f } );
+    c.push_back( { x,        100.0f } );
+    c.push_back( { x + 1.0f, 100.0f } );
+    c.push_back( { x + 1.0f, 0.0f } );
+  }
+  c.push_back( { 2.0f * teeth, -1.0f } );
+  c.push_back( { 0.0f, -1.0f } );
+  return c;
+}
+
+// Thick spiral with ten turns
+static std::vector<Vec2r> spiral_polygon(int n)
+{
+  std::vector<Vec2r> c;
+  int   half  = maximum(2, n / 2);
+  float turns = 10.0f;
+  float a     = 1.0f;
+  float width = 0.5f * 2.0f * pi * a;
+
+  for (int i = 0; i < half; ++i)
+  {
+    float phi = 2.0f * pi + 2.0f * pi * turns * i / (half-1);
+    float r = a * phi;
+    c.push_back( { r*cosf(phi), r*sinf(phi) } );
+  }
+  for (int i = half-1; i >= 0; --i)
+  {
+    float phi = 2.0f * pi + 2.0f * pi * turns * i / (half-1);
+    float r = a * phi + width;
+    c.push_back( { r*cosf(phi), r*sinf(phi) } );
+  }
+  return c;
+}
+
+// Shifted copy of a coordinate list
+static std::vector<Vec2r> shifted(std::vector<Vec2r> c,
+                                  const Vec2r& d)
+{
+  for (auto& v : c)
+    v += d;
+  return c;
+}
+
+// Coordinate list scaled into a square of the given size
+static std::vector<Vec2f> fitted(const std::vector<Vec2r>& c, 
+                                 float size)
+{
+  Vec2r lo = c[0], hi = c[0];
+  for (const auto& v : c)
+  {
+    lo = bbox_min(lo, v);
+    hi = bbox_max(hi, v);
+  }
+
+  Real s = size / maximum(hi[0] - lo[0], hi[1] - lo[1]);
+  std::vector<Vec2f> screen;
+  for (const auto& v : c)
+    screen.push_back( { float((v[0] - lo[0]) * s), 
+                        float((v[1] - lo[1]) * s) } );
+  return screen;
+}
+
+/***********************************************************
+* Measure a kernel. Returns the time per call in [ns] or
+* a negative value, if a single call exceeds the time limit
+***********************************************************/
+static double measure(const std::function<void()>& kernel)
+{
+  auto t0 = Clock::now();
+  kernel();
+  double first = std::chrono::duration<double>(Clock::now()-t0).count();
+
+  if (first > max_call)
+    return -1.0;
+
+  long long calls = 0;
+  double elapsed = 0.0;
+  t0 = Clock::now();
+  while (elapsed < min_time)
+  {
+    kernel();
+    ++calls;
+    elapsed = std::chrono::duration<double>(Clock::now()-t0).count();
+  }
+
+  return 1.0E9 * elapsed / calls;
+}
+
+/***********************************************************
+* Print a scaling curve of a kernel over all input sizes
+* Returns the largest size, that has been measured
+***********************************************************/
+using SizedKernel = std::function<std::function<void()>(int)>;
+
+static int run_curve(const std::string& name,
+                      const std::vector<int>& sizes,
+                      const SizedKernel& setup,
+                      double ops_per_call = 1.0)
+{
+  std::cout << "\n" << name << "\n";
+  std::cout << std::setw(10) << "n"
+            << std::setw(16) << "ns/op"
+            << std::setw(10) << "exp" << "\n";
+
+  double last_t   = -1.0;
+  double last_exp = 1.0;
+  int    last_n   = 0;
+
+  for (int n : sizes)
+  {
+    // Skip sizes that are expected to exceed the time limit
+    if (last_t > 0.0 && 
+        1.0E-9 * last_t * pow(double(n)/last_n, last_exp) > max_call)
+    {
+      std::cout << std::setw(10) << n 
+                << std::setw(16) << "skipped" << "\n";
+      break;
+    }
+
+    std::function<void()> kernel = setup(n);
+    double t = measure(kernel) / ops_per_call;
+
+    std::cout << std::setw(10) << n;
+    if (t < 0.0)
+    {
+      std::cout << std::setw(16) << "timeout" << "\n";
+      break;
+    }
+
+    std::cout << std::setw(16) << std::fixed << std::setprecision(1) << t;
+
+    // Scaling exponent: t ~ n^exp
+    if (last_t > 0.0)
+    {
+      last_exp = maximum(1.0, log(t / last_t) / log(double(n) / last_n));
+      std::cout << std::setw(10) << std::setprecision(2)
+                << log(t / last_t) / log(double(n) / last_n);
+    }
+    std::cout << "\n";
+
+    last_t = t;
+    last_n = n;
+  }
+
+  return last_n;
+}
+
+/***********************************************************
+* Function to parse a numeric argument, which must consist
+* of the number only
+***********************************************************/
+static bool parse(const char* arg, int& value)
+{
+  char* end = nullptr;
+  errno = 0;
+  long v = std::strtol(arg, &end, 10);
+
+  if (end == arg || *end != '\0' || errno == ERANGE ||
+      v < std::numeric_limits<int>::min() ||
+      v > std::numeric_limits<int>::max())
+    return false;
+
+  value = int(v);
+  return true;
+}
+
+/***********************************************************
+* Main
+***********************************************************/
+int main(int argc, char* argv[])
+{
+  std::string filter = (argc > 1) ? argv[1] : "";
+  int max_size       = 1000000;
+
+  if (argc > 3 || (argc > 2 && !parse(argv[2], max_size)))
+  {
+    std::cerr << "Usage: cad_tool_bench [kernel filter] [max size]\n";
+    return 1;
+  }
+
+  std::vector<int> sizes;
+  for (int n = 10; n <= max_size; n *= 10)
+    sizes.push_back(n);
+
+  auto enabled = [&](const std::string& name)
+  { return filter.empty() || name.find(filter) != std::string::npos; };
+
+  ModelSpace space;
+
+  using Generator = std::vector<Vec2r>(*)(int);
+  std::vector<std::pair<std::string, Generator>> generators =
+  {
+    { "random", random_polygon },
+    { "star",   star_polygon },
+    { "comb",   comb_polygon },
+    { "spiral", spiral_polygon }
+  };
+
+  /*--------------------------------------------------------
+  | Point predicates on random points
+  --------------------------------------------------------*/
+  if (enabled("orientation") || enabled("line_intersection"))
+  {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> coord(-1.0f, 1.0f);
+    std::vector<Vec2r> c;
+    for (int i = 0; i < 4096; ++i)
+      c.push_back( { coord(gen), coord(gen) } );
+    int n = c.size();
+
+    if (enabled("orientation"))
+      run_curve("orientation", {n}, [&](int n)
+      {
+        return [&c, n]()
+        {
+          long long s = 0;
+          for (int i = 0; i < n-2; ++i)
+            s += int(orientation(c[i], c[i+1], c[i+2]));
+          sink += s;
+        };
+      }, n-2);
+
+    if (enabled("line_intersection"))
+      run_curve("line_intersection", {n}, [&](int n)
+      {
+        return [&c, n]()
+        {
+          long long s = 0;
+          for (int i = 0; i < n-3; ++i)
+            s += line_intersection(c[i], c[i+1], c[i+2], c[i+3]);
+          sink += s;
+        };
+      }, n-3);
+  }
+
+  /*--------------------------------------------------------
+  | Shape kernels on all input polygons
+  --------------------------------------------------------*/
+  for (auto& g : generators)
+  {
+    Generator gen = g.second;
+
+    if (enabled("valid"))
+      run_curve("Shape::valid [" + g.first + "]", sizes, [&](int n)
+      {
+        auto s = std::make_shared<BenchPolygon>(space, gen(n));
+        return [s]() { sink += s->valid(); };
+      });
+
+    if (enabled("contains_node"))
+      run_curve("Shape::contains_node [" + g.first + "]", sizes,
+      [&](int n)
+      {
+        auto s = std::make_shared<BenchPolygon>(space, gen(n));
+        return [s]() { sink += s->contains_node( {0.0f, 0.0f} ); };
+      });
+
+    if (enabled("prepare_poly_intersection"))
+      run_curve("prepare_poly_intersection [" + g.first + "]", sizes,
+      [&](int n)
+      {
+        std::vector<Vec2r> c = gen(n);
+        auto a = std::make_shared<BenchPolygon>(space, c);
+        auto b = std::make_shared<BenchPolygon>(space,
+                   shifted(c, {0.25f, 0.25f}));
+        return [a, b]()
+        {
+          IntersectData* data = prepare_poly_intersection(a.get(), b.get());
+          sink += (data != nullptr);
+          delete data;
+        };
+      });
+
+    if (enabled("merge"))
+      run_curve("Shape::merge [" + g.first + "]", sizes, [&](int n)
+      {
+        std::vector<Vec2r> c = gen(n);
+        auto a = std::make_shared<BenchPolygon>(space, c);
+        auto b = std::make_shared<BenchPolygon>(space,
+                   shifted(c, {0.25f, 0.25f}));
+        return [a, b]()
+        {
+          Shape* s = a->merge(b.get());
+          sink += (s != nullptr);
+          delete s;
+        };
+      });
+
+    if (enabled("clip"))
+      run_curve("Shape::clip [" + g.first + "]", sizes, [&](int n)
+      {
+        std::vector<Vec2r> c = gen(n);
+        auto a = std::make_shared<BenchPolygon>(space, c);
+        auto b = std::make_shared<BenchPolygon>(space,
+                   shifted(c, {0.25f, 0.25f}));
+        return [a, b]()
+        {
+          std::vector<Shape*> s = a->clip(b.get());
+          sink += s.size();
+          for (auto shape : s)
+            delete shape;
+        };
+      });
+
+    if (enabled("triangulate"))
+      run_curve("triangulate [" + g.first + "]", sizes, [&](int n)
+      {
+        std::vector<Vec2r> c = gen(n);
+        return [c]() { sink += triangulate(c).triangles.size(); };
+      });
+
+    if (enabled("convex_hull"))
+      run_curve("convex_hull [" + g.first + "]", sizes, [&](int n)
+      {
+        std::vector<Vec2r> c = gen(n);
+        return [c]() { sink += convex_hull(c).size(); };
+      });
+
+    if (enabled("convex_decomposition"))
+      run_curve("convex_decomposition [" + g.first + "]", sizes, 
+      [&](int n)
+      {
+        Triangulation t = triangulate(gen(n));
+        return [t]() { sink += convex_decomposition(t).size(); };
+      });
+
+    if (enabled("mesh"))
+      run_curve("Mesh::generate [" + g.first + "]", sizes, [&](int n)
+      {
+        // Constrained triangulation only, without refinement
+        std::vector<std::vector<Vec2r>> rings { gen(n) };
+        auto mesh = std::make_shared<Mesh>();
+        return [rings, mesh]()
+        {
+          mesh->generate(rings, 0.0);
+          sink += mesh->number_of_elements();
+        };
+      });
+
+    if (enabled("size_field"))
+    {
+      int built = run_curve("SizeField::update [" + g.first + "]", sizes,
+      [&](int n)
+      {
+        auto s = std::make_shared<BenchPolygon>(space, gen(n));
+        auto field = std::make_shared<SizeField>();
+        return [s, field]()
+        {
+          field->clear();
+          field->update(s.get());
+          sink += field->number_of_edges();
+        };
+      });
+
+      // Long, narrow spikes make the setup of the largest
+      // inputs too slow, so queries stop at the built sizes
+      std::vector<int> query_sizes;
+      for (int n : sizes)
+        if (n <= built)
+          query_sizes.push_back(n);
+
+      run_curve("SizeField::size [" + g.first + "]", query_sizes, [&](int n)
+      {
+        auto s = std::make_shared<BenchPolygon>(space, gen(n));
+        auto field = std::make_shared<SizeField>();
+        field->update(s.get());
+
+        // Query points spread over the bounding box
+        std::vector<Vec2r> points;
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> u(0.0f, 1.0f);
+        Vec2r lo = s->get_node(0)->coords(), hi = lo;
+        for (int i = 1; i < s->number_of_nodes(); ++i)
+        {
+          lo = bbox_min(lo, s->get_node(i)->coords());
+          hi = bbox_max(hi, s->get_node(i)->coords());
+        }
+        for (int i = 0; i < 1024; ++i)
+          points.push_back( lo + (hi - lo) * Vec2r { u(rng), u(rng) } );
+
+        auto k = std::make_shared<int>(0);
+        return [s, field, points, k]()
+        {
+          sink += field->size( points[(*k)++ & 1023] );
+        };
+      });
+    }
+
+    if (enabled("snap"))
+      run_curve("SnapIndex::snap [" + g.first + "]", sizes, [&](int n)
+      {
+        auto s = std::make_shared<BenchPolygon>(space, gen(n));
+        auto index = std::make_shared<SnapIndex>();
+        index->update(s.get());
+
+        // Query points next to the nodes, within a radius of
+        // a tenth of the mean edge length
+        std::vector<Vec2r> points;
+        int N = s->number_of_nodes();
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        std::uniform_int_distribution<int> node(0, N - 1);
+        float length = 0.0f;
+        for (int i = 0; i < N; ++i)
+          length += (s->get_node((i + 1) % N)->coords()
+                   - s->get_node(i)->coords()).length();
+        float radius = 0.1f * length / N;
+        for (int i = 0; i < 1024; ++i)
+          points.push_back( s->get_node(node(rng))->coords()
+                          + Vec2r { u(rng), u(rng) } * radius );
+
+        auto k = std::make_shared<int>(0);
+        return [s, index, points, radius, k]()
+        {
+          SnapTarget t = index->snap( points[(*k)++ & 1023], radius );
+          sink += int(t.type);
+        };
+      });
+
+    if (enabled("fill"))
+    {
+      // Small inputs are bound by the number of pixels, which
+      // would distort the predicted scaling
+      std::vector<int> fill_sizes;
+      for (int n : sizes)
+        if (n >= 100)
+          fill_sizes.push_back(n);
+
+      run_curve("Rasterizer::fill [" + g.first + "]", fill_sizes, [&](int n)
+      {
+        // Polygon fitted into a 1024 x 1024 target
+        auto target = std::make_shared<olc::Sprite>(1024, 1024);
+        auto raster = std::make_shared<Rasterizer>();
+        raster->add_ring( fitted(gen(n), 1024.0f) );
+        return [target, raster]()
+        {
+          raster->fill(target.get(), olc::WHITE, FillRule::EvenOdd);
+          sink += target->GetData()[512 * 1024 + 512].r;
+        };
+      });
+    }
+  }
+
+  /*--------------------------------------------------------
+  | Span primitives over n pixels
+  --------------------------------------------------------*/
+  if (enabled("span"))
+  {
+    auto row = std::make_shared<std::vector<olc::Pixel>>(sizes.back());
+
+    run_curve("fill_span", sizes, [&](int n)
+    {
+      return [row, n]()
+      {
+        fill_span(row->data(), 0, n, olc::Pixel(0, 64, 96));
+        sink += (*row)[n / 2].g;
+      };
+    });
+
+    run_curve("blend_span", sizes, [&](int n)
+    {
+      return [row, n]()
+      {
+        blend_span(row->data(), 0, n, olc::Pixel(255, 255, 255, 64));
+        sink += (*row)[n / 2].g;
+      };
+    });
+  }
+
+  return 0;
+}
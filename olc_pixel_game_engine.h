@@ -985,7 +985,7 @@ namespace olc
 		void olc_UpdateMouseWheel(int32_t delta);
 		void olc_UpdateWindowSize(int32_t x, int32_t y);
 		void olc_UpdateViewport();
-		void olc_ConstructFontSheet();
+		void olc_ConstructFontSheet(bool bCreateDecal = true);
 		void olc_CoreUpdate();
 		void olc_PrepareEngine();
 		void olc_UpdateMouseState(int32_t button, bool state);
@@ -2926,7 +2926,7 @@ namespace olc
 		}
 	}
 
-	void PixelGameEngine::olc_ConstructFontSheet()
+	void PixelGameEngine::olc_ConstructFontSheet(bool bCreateDecal)
 	{
 		std::string data;
 		data += "?Q`0001oOch0o01o@F40o0<AGD4090LAGD<090@A7ch0?00O7Q`0600>00000000";
@@ -2964,7 +2964,9 @@ namespace olc
 			}
 		}
 
-		fontDecal = new olc::Decal(fontSprite);
+		// The decal requires an active renderer
+		if (bCreateDecal)
+			fontDecal = new olc::Decal(fontSprite);
 
 		constexpr std::array<uint8_t, 96> vSpacing = { {
 			0x03,0x25,0x16,0x08,0x07,0x08,0x08,0x04,0x15,0x15,0x08,0x07,0x15,0x07,0x24,0x08,
@@ -3547,6 +3549,29 @@ namespace olc
 
 		olc::rcode SaveImageResource(olc::Sprite* spr, const std::string& sImageFile) override
 		{
+			FILE* f = fopen(sImageFile.c_str(), "wb");
+			if (!f) return olc::rcode::NO_FILE;
+
+			png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+			png_infop info = png ? png_create_info_struct(png) : nullptr;
+			if (!png || !info || setjmp(png_jmpbuf(png)))
+			{
+				png_destroy_write_struct(&png, &info);
+				fclose(f);
+				return olc::rcode::FAIL;
+			}
+
+			// Sprite data is stored as 8 bit RGBA, one row after another
+			png_init_io(png, f);
+			png_set_IHDR(png, info, spr->width, spr->height, 8, PNG_COLOR_TYPE_RGBA,
+				PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+			png_write_info(png, info);
+			for (int y = 0; y < spr->height; y++)
+				png_write_row(png, (png_bytep)(spr->GetData() + y * spr->width));
+			png_write_end(png, nullptr);
+
+			png_destroy_write_struct(&png, &info);
+			fclose(f);
 			return olc::rcode::OK;
 		}
 	};
@@ -4348,7 +4373,9 @@ namespace olc
 #endif
 
 #if defined(OLC_IMAGE_LIBPNG)
-		olc::Sprite::loader = std::make_unique<olc::ImageLoader_LibPNG>();
+		// The loader is shared by all engine instances
+		if (!olc::Sprite::loader)
+			olc::Sprite::loader = std::make_unique<olc::ImageLoader_LibPNG>();
 #endif
 
 #if defined(OLC_IMAGE_STB)